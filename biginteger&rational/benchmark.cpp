@@ -0,0 +1,916 @@
+// Benchmarks for BigInteger and Rational. Every line of output is a JSON object.
+//
+// The "scaling" benchmark times each operation on random operands of 1, 4, 16, ... limbs (9
+// decimal digits per limb) up to max_limbs; an operation drops out once a single call takes
+// longer than seconds_per_call, since every step quadruples the size. It prints one line per
+// (operation, size), then one per operation with the exponent k of the least-squares fit
+// time ~ limbs^k over the sizes from fit_limbs on (k near 1 is linear, 1.58 Karatsuba, 2
+// quadratic). With -DWITH_GMP the same operations run on mpz_class/mpq_class as a reference:
+// their times and fits are reported next to ours and every result is compared with GMP's.
+//
+// The other benchmarks each measure one feature against the naive way of doing the same thing,
+// or against itself in another mode (lazy normalization, threads, a pinned scratch arena), and
+// check that both give the same result.
+//
+//   g++ -O2 -std=c++17 -pthread benchmark.cpp -o benchmark
+//   g++ -O2 -std=c++17 -pthread -DWITH_GMP benchmark.cpp -o benchmark -lgmpxx -lgmp
+//   ./benchmark [name...]                      runs the named benchmarks, all of them by default
+//   ./benchmark [max_limbs [seconds_per_call]] runs "scaling" only
+
+#include "biginteger&rational.cpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef WITH_GMP
+#include <gmpxx.h>
+#define GMP_REFERENCE(...) , __VA_ARGS__
+#else
+#define GMP_REFERENCE(...)
+#endif
+
+namespace {
+
+std::atomic<size_t> allocations{0};
+
+// Out of line, so that GCC does not pair the free() with a new expression it inlined next to it.
+__attribute__((noinline)) void release(void *memory) {
+  std::free(memory);
+}
+
+}  // namespace
+
+void *operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *memory = std::malloc(size)) return memory;
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void *memory) noexcept {
+  release(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept {
+  release(memory);
+}
+
+void operator delete[](void *memory) noexcept {
+  release(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept {
+  release(memory);
+}
+
+namespace {
+
+constexpr size_t fit_limbs = 64;
+constexpr double min_pass_seconds = 0.01;
+constexpr size_t horner_degree = 64;
+
+double now() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::string random_digits(std::mt19937_64 &rng, size_t limbs) {
+  std::string digits(9 * limbs, '0');
+  digits[0] = char('1' + rng() % 9);
+  for (size_t i = 1; i < digits.size(); ++i) digits[i] = char('0' + rng() % 10);
+  return digits;
+}
+
+// The operands of one size: `wide` has 2n limbs (the dividend), `a`, `b` and `c` have n; the
+// rationals a/b and b/c are only built by the operations that need them.
+struct Operands {
+  std::string a_digits;
+  BigInteger wide, a, b, c;
+  BigInteger result;
+  std::string text;
+  std::unique_ptr<Rational> x, y;
+  Rational rational_result;
+#ifdef WITH_GMP
+  mpz_class gmp_wide, gmp_a, gmp_b, gmp_c;
+  mpz_class gmp_result;
+  std::string gmp_text;
+  mpq_class gmp_x, gmp_y;
+  mpq_class gmp_rational_result;
+#endif
+
+  void make_rationals() {
+    if (x) return;
+    x = std::make_unique<Rational>(Rational(a) / Rational(b));
+    y = std::make_unique<Rational>(Rational(b) / Rational(c));
+#ifdef WITH_GMP
+    gmp_x = mpq_class(gmp_a, gmp_b);
+    gmp_x.canonicalize();
+    gmp_y = mpq_class(gmp_b, gmp_c);
+    gmp_y.canonicalize();
+#endif
+  }
+};
+
+enum class Result { integer, rational, text };
+
+struct Operation {
+  const char *name;
+  Result result;
+  std::function<void(Operands &)> run;
+#ifdef WITH_GMP
+  std::function<void(Operands &)> run_gmp;
+#endif
+};
+
+// (limbs, seconds) of one operation, ours and GMP's; `done` once it got too slow to go on.
+struct Curve {
+  bool done = false;
+  std::vector<std::pair<double, double>> points, gmp_points;
+};
+
+// Average seconds per call, best of three passes of at least min_pass_seconds each; a single
+// pass when one call already takes long.
+double seconds_per_call(const std::function<void()> &run) {
+  double best = std::numeric_limits<double>::infinity();
+  for (int pass = 0; pass < 3; ++pass) {
+    size_t calls = 0;
+    double start = now();
+    double elapsed;
+    do {
+      run();
+      ++calls;
+      elapsed = now() - start;
+    } while (elapsed < min_pass_seconds);
+    best = std::min(best, elapsed / calls);
+    if (elapsed > 0.5) break;
+  }
+  return best;
+}
+
+double seconds_per_call(const std::function<void(Operands &)> &run, Operands &operands) {
+  return seconds_per_call([&run, &operands] { run(operands); });
+}
+
+// Heap allocations of one call, after a first call has warmed up the scratch arena.
+size_t allocations_per_call(const std::function<void()> &run) {
+  run();
+  size_t before = allocations.load(std::memory_order_relaxed);
+  run();
+  return allocations.load(std::memory_order_relaxed) - before;
+}
+
+BigInteger random_integer(std::mt19937_64 &rng, size_t limbs) {
+  BigInteger result;
+  result.build_string(random_digits(rng, limbs));
+  return result;
+}
+
+// Results of the benchmarks that disagree with their reference; main fails when there are any.
+int mismatches = 0;
+
+const char *check(bool same) {
+  mismatches += !same;
+  return same ? "ok" : "MISMATCH";
+}
+
+// Exponent of the least-squares fit of log(seconds) against log(limbs).
+bool fit_exponent(const std::vector<std::pair<double, double>> &points, double &exponent) {
+  double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+  for (auto [limbs, seconds] : points) {
+    if (limbs < fit_limbs) continue;
+    double x = std::log(limbs), y = std::log(seconds);
+    n += 1;
+    sx += x;
+    sy += y;
+    sxx += x * x;
+    sxy += x * y;
+  }
+  if (n < 2) return false;
+  exponent = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+  return true;
+}
+
+#ifdef WITH_GMP
+bool same_result(const Operation &operation, const Operands &o) {
+  switch (operation.result) {
+    case Result::integer: return o.result.toString() == o.gmp_result.get_str();
+    case Result::rational: return o.rational_result.toString() == o.gmp_rational_result.get_str();
+    case Result::text: return o.text == o.gmp_text;
+  }
+  return false;
+}
+#endif
+
+std::vector<Operation> operations() {
+  std::vector<Operation> list = {
+      {"add", Result::integer, [](Operands &o) { o.result = o.a + o.b; }
+       GMP_REFERENCE([](Operands &o) { o.gmp_result = o.gmp_a + o.gmp_b; })},
+      {"sub", Result::integer, [](Operands &o) { o.result = o.b - o.a; }
+       GMP_REFERENCE([](Operands &o) { o.gmp_result = o.gmp_b - o.gmp_a; })},
+      {"mul", Result::integer, [](Operands &o) { o.result = o.a * o.b; }
+       GMP_REFERENCE([](Operands &o) { o.gmp_result = o.gmp_a * o.gmp_b; })},
+      {"div", Result::integer, [](Operands &o) { o.result = o.wide / o.a; }
+       GMP_REFERENCE([](Operands &o) { o.gmp_result = o.gmp_wide / o.gmp_a; })},
+      {"mod", Result::integer, [](Operands &o) { o.result = o.wide % o.a; }
+       GMP_REFERENCE([](Operands &o) { o.gmp_result = o.gmp_wide % o.gmp_a; })},
+      {"gcd", Result::integer, [](Operands &o) { o.result = gcd(o.a, o.b); }
+       GMP_REFERENCE([](Operands &o) { o.gmp_result = gcd(o.gmp_a, o.gmp_b); })},
+      {"to_string", Result::text, [](Operands &o) { o.text = o.a.toString(); }
+       GMP_REFERENCE([](Operands &o) { o.gmp_text = o.gmp_a.get_str(); })},
+      {"parse", Result::integer, [](Operands &o) { o.result.build_string(o.a_digits); }
+       GMP_REFERENCE([](Operands &o) { o.gmp_result.set_str(o.a_digits, 10); })},
+      // acc = acc * a + c, horner_degree times: the accumulator outgrows a, so this exercises
+      // unbalanced products and the buffer reuse of evaluate().
+      {"horner", Result::integer,
+       [](Operands &o) {
+         o.result = o.c;
+         for (size_t i = 0; i < horner_degree; ++i) evaluate(o.result, lazy(o.result) * o.a + o.c);
+       }
+       GMP_REFERENCE([](Operands &o) {
+         o.gmp_result = o.gmp_c;
+         for (size_t i = 0; i < horner_degree; ++i) {
+           o.gmp_result *= o.gmp_a;
+           o.gmp_result += o.gmp_c;
+         }
+       })},
+      {"rational_add", Result::rational, [](Operands &o) { o.rational_result = *o.x + *o.y; }
+       GMP_REFERENCE([](Operands &o) { o.gmp_rational_result = o.gmp_x + o.gmp_y; })},
+      {"rational_mul", Result::rational, [](Operands &o) { o.rational_result = *o.x * *o.y; }
+       GMP_REFERENCE([](Operands &o) { o.gmp_rational_result = o.gmp_x * o.gmp_y; })},
+  };
+  return list;
+}
+
+void print_fit(const char *key, const std::vector<std::pair<double, double>> &points) {
+  double exponent;
+  if (fit_exponent(points, exponent)) {
+    std::printf(", \"%s\": %.3f", key, exponent);
+  } else {
+    std::printf(", \"%s\": null", key);
+  }
+}
+
+void run_scaling(size_t max_limbs, double seconds_limit) {
+  std::mt19937_64 rng(20240601);
+  std::vector<Operation> list = operations();
+  std::vector<Curve> curves(list.size());
+  for (size_t limbs = 1; limbs <= max_limbs; limbs *= 4) {
+    bool active = false;
+    for (const Curve &curve : curves) active = active || !curve.done;
+    if (!active) break;
+    Operands o;
+    o.a_digits = random_digits(rng, limbs);
+    std::string b_digits = random_digits(rng, limbs);
+    std::string c_digits = random_digits(rng, limbs);
+    std::string wide_digits = random_digits(rng, 2 * limbs);
+    o.a.build_string(o.a_digits);
+    o.b.build_string(b_digits);
+    o.c.build_string(c_digits);
+    o.wide.build_string(wide_digits);
+#ifdef WITH_GMP
+    o.gmp_a.set_str(o.a_digits, 10);
+    o.gmp_b.set_str(b_digits, 10);
+    o.gmp_c.set_str(c_digits, 10);
+    o.gmp_wide.set_str(wide_digits, 10);
+#endif
+    for (size_t i = 0; i < list.size(); ++i) {
+      const Operation &operation = list[i];
+      Curve &curve = curves[i];
+      if (curve.done) continue;
+      if (operation.result == Result::rational) o.make_rationals();
+      double seconds = seconds_per_call(operation.run, o);
+      curve.points.emplace_back(double(limbs), seconds);
+      curve.done = seconds > seconds_limit;
+      std::printf("{\"op\": \"%s\", \"limbs\": %zu, \"digits\": %zu, \"seconds\": %.6e", operation.name, limbs,
+                  9 * limbs, seconds);
+#ifdef WITH_GMP
+      double gmp_seconds = seconds_per_call(operation.run_gmp, o);
+      curve.gmp_points.emplace_back(double(limbs), gmp_seconds);
+      bool same = same_result(operation, o);
+      mismatches += !same;
+      std::printf(", \"gmp_seconds\": %.6e, \"ratio\": %.2f, \"check\": \"%s\"", gmp_seconds, seconds / gmp_seconds,
+                  same ? "ok" : "MISMATCH");
+#endif
+      std::printf("}\n");
+      std::fflush(stdout);
+    }
+  }
+  for (size_t i = 0; i < list.size(); ++i) {
+    std::printf("{\"op\": \"%s\", \"fit_from_limbs\": %zu", list[i].name, fit_limbs);
+    print_fit("exponent", curves[i].points);
+#ifdef WITH_GMP
+    print_fit("gmp_exponent", curves[i].gmp_points);
+#endif
+    std::printf("}\n");
+  }
+}
+
+void benchmark_scaling() {
+  run_scaling(size_t(1) << 20, 2.0);
+}
+
+template<typename T>
+void report_chain(const char *name, size_t limbs, const std::function<T()> &chain, const std::function<T()> &named) {
+  T result, named_result;
+  auto run_chain = [&] { result = chain(); };
+  auto run_named = [&] { named_result = named(); };
+  std::printf("{\"benchmark\": \"expression_chain\", \"case\": \"%s\", \"limbs\": %zu, \"seconds\": %.6e, "
+              "\"allocations\": %zu, \"named_seconds\": %.6e, \"named_allocations\": %zu, \"check\": \"%s\"}\n", name,
+              limbs, seconds_per_call(run_chain), allocations_per_call(run_chain), seconds_per_call(run_named),
+              allocations_per_call(run_named), check(result == named_result));
+}
+
+template<typename T>
+void report_regrow(const char *type, const T &value) {
+  const size_t elements = 10000;
+  std::vector<T> values(elements, value);
+  size_t before = allocations.load(std::memory_order_relaxed);
+  double start = now();
+  values.reserve(2 * elements);
+  double seconds = now() - start;
+  std::printf("{\"benchmark\": \"expression_chain\", \"case\": \"vector_regrow\", \"type\": \"%s\", "
+              "\"elements\": %zu, \"seconds\": %.6e, \"allocations\": %zu}\n", type, elements, seconds,
+              allocations.load(std::memory_order_relaxed) - before);
+}
+
+// Allocations of long expressions, where the rvalue overloads let every operator reuse the
+// temporary on its left, against the same expression spelled with named intermediates, each of
+// which gets a buffer of its own. Then the moves of a growing std::vector, which should only
+// allocate the new array.
+void benchmark_expression_chain() {
+  std::mt19937_64 rng(26);
+  for (size_t limbs : {size_t(4), size_t(100)}) {
+    BigInteger a = random_integer(rng, limbs), b = random_integer(rng, limbs), c = random_integer(rng, limbs);
+    BigInteger d = random_integer(rng, limbs), e = random_integer(rng, limbs), f = random_integer(rng, limbs);
+    report_chain<BigInteger>("sum", limbs, [&] { return a + b - c + d + e - f + 12345 - a + b; },
+                 [&] {
+                   BigInteger t1 = a + b, t2 = t1 - c, t3 = t2 + d, t4 = t3 + e, t5 = t4 - f;
+                   BigInteger t6 = t5 + 12345, t7 = t6 - a;
+                   return t7 + b;
+                 });
+    report_chain<BigInteger>("mixed", limbs, [&] { return (a * b + c) * d - e * 3 + f % a - (b + c) / d; },
+                 [&] {
+                   BigInteger t1 = a * b, t2 = t1 + c, t3 = t2 * d, t4 = e * 3, t5 = t3 - t4, t6 = f % a;
+                   BigInteger t7 = t5 + t6, t8 = b + c, t9 = t8 / d;
+                   return t7 - t9;
+                 });
+    Rational x = Rational(a) / Rational(b), y = Rational(c) / Rational(d);
+    report_chain<Rational>("rational", limbs, [&] { return (x + y) * x - y / x + 7 - e; },
+                           [&] {
+                             Rational t1 = x + y, t2 = t1 * x, t3 = y / x, t4 = t2 - t3, t5 = t4 + 7;
+                             return t5 - e;
+                           });
+  }
+  report_regrow("BigInteger", random_integer(rng, 100));
+  report_regrow("Rational", Rational(random_integer(rng, 100)) / Rational(random_integer(rng, 100)));
+}
+
+// H_n = 1 + 1/2 + ... + 1/n reduced after every term, with lazy normalization, and kept as an
+// unreduced sum over n! that is reduced once at the end.
+void benchmark_harmonic() {
+  for (int terms : {1000, 10000}) {
+    auto harmonic = [terms] {
+      Rational sum = 0;
+      for (int k = 1; k <= terms; ++k) sum += Rational(1) / Rational(k);
+      return sum;
+    };
+    Rational eager, lazy, unreduced;
+    double eager_seconds = seconds_per_call([&] { eager = harmonic(); });
+    Rational::set_lazy_normalization(true);
+    double lazy_seconds = seconds_per_call([&] { lazy = harmonic(); });
+    Rational::set_lazy_normalization(false);
+    double unreduced_seconds = seconds_per_call([&] {
+      BigInteger p = 0, q = 1;
+      for (int k = 1; k <= terms; ++k) {
+        p = p * k + q;
+        q *= k;
+      }
+      unreduced = Rational(p) / Rational(q);
+    });
+    std::printf("{\"benchmark\": \"harmonic\", \"terms\": %d, \"seconds\": %.6e, \"lazy_seconds\": %.6e, "
+                "\"unreduced_seconds\": %.6e, \"check\": \"%s\"}\n", terms, eager_seconds, lazy_seconds,
+                unreduced_seconds, check(eager == lazy && eager == unreduced));
+  }
+}
+
+// std::sort of a million random fractions with Rational::operator<, which settles most pairs
+// by sign and size without multiplying, against the same fractions kept as (p, q) pairs and
+// ordered by the cross products p1 * q2 < p2 * q1.
+void benchmark_sort() {
+  const size_t count = 1000000;
+  std::mt19937_64 rng(28);
+  for (size_t limbs : {size_t(1), size_t(4)}) {
+    std::vector<std::pair<BigInteger, BigInteger>> pairs;
+    std::vector<Rational> values;
+    pairs.reserve(count);
+    values.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+      BigInteger p = random_integer(rng, limbs), q = random_integer(rng, limbs);
+      if (rng() % 2) p = -p;
+      values.push_back(Rational(p) / Rational(q));
+      pairs.emplace_back(std::move(p), std::move(q));
+    }
+    size_t before = allocations.load(std::memory_order_relaxed);
+    double start = now();
+    std::sort(values.begin(), values.end());
+    double seconds = now() - start;
+    size_t sort_allocations = allocations.load(std::memory_order_relaxed) - before;
+    start = now();
+    std::sort(pairs.begin(), pairs.end(), [](const auto &x, const auto &y) {
+      return x.first * y.second < y.first * x.second;
+    });
+    double naive_seconds = now() - start;
+    bool same = true;
+    for (size_t i = 0; i < count && same; ++i) same = values[i] == Rational(pairs[i].first) / Rational(pairs[i].second);
+    std::printf("{\"benchmark\": \"sort\", \"count\": %zu, \"limbs\": %zu, \"seconds\": %.6e, \"allocations\": %zu, "
+                "\"naive_seconds\": %.6e, \"check\": \"%s\"}\n", count, limbs, seconds, sort_allocations,
+                naive_seconds, check(same));
+  }
+}
+
+// a^e mod m for a 2048- and a 4096-bit modulus coprime to 10 and an exponent as long:
+// MontgomeryContext::powmod, in its default and constant-time modes, against square-and-multiply
+// with operator* and operator%.
+void benchmark_powmod() {
+  std::mt19937_64 rng(29);
+  const BigInteger two = 2, ten = 10;
+  for (unsigned bits : {2048u, 4096u}) {
+    size_t limbs = size_t(bits * 0.30103) / 9 - 1;
+    BigInteger modulus = pow(BigInteger(2), bits - 1) + random_integer(rng, limbs);
+    while (gcd(modulus, ten) != 1) modulus += 1;
+    BigInteger a = random_integer(rng, limbs), exponent = random_integer(rng, limbs);
+    MontgomeryContext context(modulus), constant_time_context(modulus, true);
+    BigInteger result, constant_time_result, naive_result;
+    double seconds = seconds_per_call([&] { result = context.powmod(a, exponent); });
+    double constant_time_seconds = seconds_per_call([&] {
+      constant_time_result = constant_time_context.powmod(a, exponent);
+    });
+    double naive_seconds = seconds_per_call([&] {
+      BigInteger power = a % modulus, e = exponent;
+      naive_result = 1;
+      while (e > 0) {
+        if (e % two == 1) naive_result = naive_result * power % modulus;
+        power = power * power % modulus;
+        e /= 2;
+      }
+    });
+    std::printf("{\"benchmark\": \"powmod\", \"bits\": %u, \"seconds\": %.6e, \"constant_time_seconds\": %.6e, "
+                "\"naive_seconds\": %.6e, \"check\": \"%s\"}\n", bits, seconds, constant_time_seconds, naive_seconds,
+                check(result == naive_result && constant_time_result == naive_result));
+  }
+}
+
+// x^k by repeated multiplication.
+BigInteger naive_pow(const BigInteger &x, unsigned k) {
+  BigInteger result = 1;
+  for (unsigned i = 0; i < k; ++i) result *= x;
+  return result;
+}
+
+// floor(n^(1/k)) for n >= 1 by doubling an upper bound and then bisecting.
+BigInteger naive_root(const BigInteger &n, unsigned k) {
+  BigInteger high = 1;
+  while (naive_pow(high, k) <= n) high *= 2;
+  BigInteger low = high / 2;
+  while (high - low > 1) {
+    BigInteger middle = (low + high) / 2;
+    if (naive_pow(middle, k) <= n) {
+      low = middle;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+void report_pow_roots(const char *op, size_t limbs, unsigned k, const std::function<BigInteger()> &run,
+                      const std::function<BigInteger()> &naive) {
+  BigInteger result, naive_result;
+  double seconds = seconds_per_call([&] { result = run(); });
+  double naive_seconds = seconds_per_call([&] { naive_result = naive(); });
+  std::printf("{\"benchmark\": \"pow_roots\", \"op\": \"%s\", \"limbs\": %zu, \"k\": %u, \"seconds\": %.6e, "
+              "\"naive_seconds\": %.6e, \"check\": \"%s\"}\n", op, limbs, k, seconds, naive_seconds,
+              check(result == naive_result));
+}
+
+// pow, isqrt and iroot against the loops they replace: repeated multiplication for powers, and
+// bisection with those powers for roots.
+void benchmark_pow_roots() {
+  std::mt19937_64 rng(30);
+  BigInteger x = random_integer(rng, 10);
+  for (unsigned k : {100u, 1000u}) {
+    report_pow_roots("pow", 10, k, [&] { return pow(x, k); }, [&] { return naive_pow(x, k); });
+  }
+  for (size_t limbs : {size_t(100), size_t(1000)}) {
+    BigInteger n = random_integer(rng, limbs);
+    report_pow_roots("isqrt", limbs, 2, [&] { return isqrt(n); }, [&] { return naive_root(n, 2); });
+    report_pow_roots("iroot", limbs, 5, [&] { return iroot(n, 5); }, [&] { return naive_root(n, 5); });
+  }
+}
+
+// A limb kernel as the benchmark calls it: x is the factor, the divisor or the shift count, and
+// b and x are ignored where unused.
+using KernelFunction = int (*)(int *r, const int *a, const int *b, size_t n, int x);
+
+struct Kernel {
+  const char *name;
+  bool shift;
+  KernelFunction run;
+  KernelFunction naive;
+};
+
+// The kernels against the carry loops they replaced, with a branch or a `%` per limb; shifts
+// against multiplication and division by the power of two.
+const Kernel kernels[] = {
+    {"add_n", false, [](int *r, const int *a, const int *b, size_t n, int) { return biginteger_detail::add_n(r, a, b, n); },
+     [](int *r, const int *a, const int *b, size_t n, int) {
+       int carry = 0;
+       for (size_t i = 0; i < n; ++i) {
+         r[i] = a[i] + b[i] + carry;
+         carry = r[i] >= biginteger_detail::limb_base;
+         if (carry) r[i] -= biginteger_detail::limb_base;
+       }
+       return carry;
+     }},
+    {"sub_n", false, [](int *r, const int *a, const int *b, size_t n, int) { return biginteger_detail::sub_n(r, a, b, n); },
+     [](int *r, const int *a, const int *b, size_t n, int) {
+       int borrow = 0;
+       for (size_t i = 0; i < n; ++i) {
+         r[i] = a[i] - b[i] - borrow;
+         borrow = r[i] < 0;
+         if (borrow) r[i] += biginteger_detail::limb_base;
+       }
+       return borrow;
+     }},
+    {"mul_1", false, [](int *r, const int *a, const int *, size_t n, int x) { return biginteger_detail::mul_1(r, a, n, x); },
+     [](int *r, const int *a, const int *, size_t n, int x) {
+       long long carry = 0;
+       for (size_t i = 0; i < n; ++i) {
+         long long curr = 1ll * a[i] * x + carry;
+         r[i] = int(curr % biginteger_detail::limb_base);
+         carry = curr / biginteger_detail::limb_base;
+       }
+       return int(carry);
+     }},
+    {"addmul_1", false,
+     [](int *r, const int *a, const int *, size_t n, int x) { return biginteger_detail::addmul_1(r, a, n, x); },
+     [](int *r, const int *a, const int *, size_t n, int x) {
+       long long carry = 0;
+       for (size_t i = 0; i < n; ++i) {
+         long long curr = 1ll * a[i] * x + r[i] + carry;
+         r[i] = int(curr % biginteger_detail::limb_base);
+         carry = curr / biginteger_detail::limb_base;
+       }
+       return int(carry);
+     }},
+    {"submul_1", false,
+     [](int *r, const int *a, const int *, size_t n, int x) { return biginteger_detail::submul_1(r, a, n, x); },
+     [](int *r, const int *a, const int *, size_t n, int x) {
+       long long carry = 0;
+       for (size_t i = 0; i < n; ++i) {
+         long long curr = r[i] - 1ll * a[i] * x - carry;
+         carry = 0;
+         if (curr < 0) {
+           carry = (-curr + biginteger_detail::limb_base - 1) / biginteger_detail::limb_base;
+           curr += carry * biginteger_detail::limb_base;
+         }
+         r[i] = int(curr);
+       }
+       return int(carry);
+     }},
+    {"divrem_1", false,
+     [](int *r, const int *a, const int *, size_t n, int x) { return biginteger_detail::divrem_1(r, a, n, x); },
+     [](int *r, const int *a, const int *, size_t n, int x) {
+       long long rest = 0;
+       for (size_t i = n; i > 0; --i) {
+         long long curr = rest * biginteger_detail::limb_base + a[i - 1];
+         r[i - 1] = int(curr / x);
+         rest = curr % x;
+       }
+       return int(rest);
+     }},
+    {"lshift_1", true,
+     [](int *r, const int *a, const int *, size_t n, int x) { return biginteger_detail::lshift_1(r, a, n, x); },
+     [](int *r, const int *a, const int *, size_t n, int x) {
+       return biginteger_detail::mul_1(r, a, n, 1 << x);
+     }},
+    {"rshift_1", true,
+     [](int *r, const int *a, const int *, size_t n, int x) { return biginteger_detail::rshift_1(r, a, n, x); },
+     [](int *r, const int *a, const int *, size_t n, int x) {
+       return biginteger_detail::divrem_1(r, a, n, 1 << x);
+     }},
+};
+
+// Nanoseconds per limb of every limb kernel at a few lengths, against its naive loop. Each
+// timed call repeats the kernel over about 64K limbs so that the clock reads do not count.
+void benchmark_kernels() {
+  std::mt19937_64 rng(31);
+  for (size_t n : {size_t(16), size_t(256), size_t(4096)}) {
+    std::vector<int> a(n), b(n), c(n);
+    for (size_t i = 0; i < n; ++i) {
+      a[i] = int(rng() % biginteger_detail::limb_base);
+      b[i] = int(rng() % biginteger_detail::limb_base);
+      c[i] = int(rng() % biginteger_detail::limb_base);
+    }
+    // Drawn at run time, so that the naive loops cannot fold them into constants either.
+    int factor = int(rng() % biginteger_detail::limb_base) | 1;
+    int shift = int(1 + rng() % 29);
+    size_t repeats = std::max<size_t>(1, 65536 / n);
+    for (const Kernel &kernel : kernels) {
+      int x = kernel.shift ? shift : factor;
+      std::vector<int> result = c, naive_result = c;
+      int out = kernel.run(result.data(), a.data(), b.data(), n, x);
+      int naive_out = kernel.naive(naive_result.data(), a.data(), b.data(), n, x);
+      auto ns_per_limb = [&](KernelFunction function) {
+        std::vector<int> r = c;
+        double seconds = seconds_per_call([&] {
+          for (size_t i = 0; i < repeats; ++i) function(r.data(), a.data(), b.data(), n, x);
+        });
+        return seconds / double(repeats * n) * 1e9;
+      };
+      std::printf("{\"benchmark\": \"kernels\", \"kernel\": \"%s\", \"limbs\": %zu, \"ns_per_limb\": %.3f, "
+                  "\"naive_ns_per_limb\": %.3f, \"check\": \"%s\"}\n", kernel.name, n, ns_per_limb(kernel.run),
+                  ns_per_limb(kernel.naive), check(out == naive_out && result == naive_result));
+    }
+  }
+}
+
+// Multiplication and division of 2^14- and 2^16-limb operands on 1, 2, 4, ... threads up to
+// the hardware concurrency, with the speedup over one thread; every thread count has to give
+// the single-threaded result.
+void benchmark_threads() {
+  unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<unsigned> thread_counts;
+  for (unsigned threads = 1; threads < max_threads; threads *= 2) thread_counts.push_back(threads);
+  thread_counts.push_back(max_threads);
+  std::mt19937_64 rng(32);
+  for (size_t limbs : {size_t(1) << 14, size_t(1) << 16}) {
+    BigInteger a = random_integer(rng, limbs), b = random_integer(rng, limbs);
+    BigInteger wide = random_integer(rng, 2 * limbs);
+    for (const char *op : {"mul", "div"}) {
+      bool mul = std::strcmp(op, "mul") == 0;
+      BigInteger expected, result;
+      double single_seconds = 0;
+      for (unsigned threads : thread_counts) {
+        BigInteger::set_parallelism(threads);
+        double seconds = seconds_per_call([&] { result = mul ? a * b : wide / a; });
+        if (threads == 1) {
+          single_seconds = seconds;
+          expected = result;
+        }
+        std::printf("{\"benchmark\": \"threads\", \"op\": \"%s\", \"limbs\": %zu, \"threads\": %u, "
+                    "\"seconds\": %.6e, \"speedup\": %.2f, \"check\": \"%s\"}\n", op, limbs, threads, seconds,
+                    single_seconds / seconds, check(result == expected));
+        std::fflush(stdout);
+      }
+    }
+  }
+  BigInteger::set_parallelism(1);
+}
+
+// Heap allocations and time per call of division, gcd and Rational arithmetic on their own,
+// where the scratch arena gives back what it grew beyond its retained size after every
+// top-level operation, and inside a BigIntegerScratch context, which keeps it.
+void benchmark_scratch() {
+  std::mt19937_64 rng(34);
+  for (size_t limbs : {size_t(10), size_t(1000), size_t(10000)}) {
+    BigInteger a = random_integer(rng, limbs), b = random_integer(rng, limbs), c = random_integer(rng, limbs);
+    BigInteger wide = random_integer(rng, 2 * limbs);
+    Rational x = Rational(a) / Rational(b), y = Rational(c) / Rational(a);
+    BigInteger result;
+    Rational rational_result;
+    struct Case {
+      const char *op;
+      std::function<void()> run;
+    };
+    const Case cases[] = {
+        {"div", [&] { result = wide / a; }},
+        {"gcd", [&] { result = gcd(a, b); }},
+        {"rational_add", [&] { rational_result = x + y; }},
+        {"rational_mul", [&] { rational_result = x * y; }},
+    };
+    for (const Case &test : cases) {
+      size_t calls = allocations_per_call(test.run);
+      double seconds = seconds_per_call(test.run);
+      BigInteger expected = result;
+      Rational rational_expected = rational_result;
+      BigIntegerScratch scratch;
+      size_t scratch_calls = allocations_per_call(test.run);
+      double scratch_seconds = seconds_per_call(test.run);
+      std::printf("{\"benchmark\": \"scratch\", \"op\": \"%s\", \"limbs\": %zu, \"seconds\": %.6e, "
+                  "\"allocations\": %zu, \"scratch_seconds\": %.6e, \"scratch_allocations\": %zu, \"check\": \"%s\"}\n",
+                  test.op, limbs, seconds, calls, scratch_seconds, scratch_calls,
+                  check(result == expected && rational_result == rational_expected));
+    }
+  }
+}
+
+// x << k, x >> k and x & (2^k - 1) on positive operands against x * 2^k, x / 2^k and
+// x % 2^k with the power of two computed once up front.
+void benchmark_shifts() {
+  std::mt19937_64 rng(35);
+  for (size_t limbs : {size_t(10), size_t(1000), size_t(10000)}) {
+    BigInteger x = random_integer(rng, limbs);
+    for (size_t k : {size_t(100), size_t(10000)}) {
+      BigInteger power = pow(BigInteger(2), k), mask = power - 1;
+      struct Case {
+        const char *op;
+        std::function<BigInteger()> run, naive;
+      };
+      const Case cases[] = {
+          {"shl", [&] { return x << k; }, [&] { return x * power; }},
+          {"shr", [&] { return x >> k; }, [&] { return x / power; }},
+          {"low_bits", [&] { return x & mask; }, [&] { return x % power; }},
+      };
+      for (const Case &test : cases) {
+        BigInteger result, naive_result;
+        double seconds = seconds_per_call([&] { result = test.run(); });
+        double naive_seconds = seconds_per_call([&] { naive_result = test.naive(); });
+        std::printf("{\"benchmark\": \"shifts\", \"op\": \"%s\", \"limbs\": %zu, \"k\": %zu, \"seconds\": %.6e, "
+                    "\"naive_seconds\": %.6e, \"check\": \"%s\"}\n", test.op, limbs, k, seconds, naive_seconds,
+                    check(result == naive_result));
+      }
+    }
+  }
+}
+
+// A random positive integer below 2^bits with about as many digits.
+BigInteger random_below_bits(std::mt19937_64 &rng, size_t bits) {
+  size_t digits = size_t(double(bits) * 0.30103);
+  BigInteger result;
+  result.build_string(random_digits(rng, digits / 9 + 1).substr(0, digits));
+  return result;
+}
+
+// Nanoseconds per operation of FixedBigInt<Bits> and BigInteger over the same operands: a
+// thousand random pairs of Bits / 2 - 1 bits, and dividends of Bits - 2 bits for / and %, so
+// that nothing wraps around.
+template<size_t Bits>
+void report_fixed(std::mt19937_64 &rng) {
+  using Fixed = FixedBigInt<Bits>;
+  const size_t count = 1000;
+  std::vector<BigInteger> a, b, wide;
+  std::vector<Fixed> fixed_a, fixed_b, fixed_wide;
+  for (size_t i = 0; i < count; ++i) {
+    a.push_back(random_below_bits(rng, Bits / 2 - 1));
+    b.push_back(random_below_bits(rng, Bits / 2 - 1));
+    wide.push_back(random_below_bits(rng, Bits - 2));
+    if (rng() % 2) a.back() = -a.back();
+    if (rng() % 2) wide.back() = -wide.back();
+    fixed_a.emplace_back(a.back());
+    fixed_b.emplace_back(b.back());
+    fixed_wide.emplace_back(wide.back());
+  }
+  auto report = [&](const char *op, const std::function<BigInteger(size_t)> &big,
+                    const std::function<Fixed(size_t)> &fixed) {
+    std::vector<BigInteger> big_results(count);
+    std::vector<Fixed> fixed_results(count);
+    double seconds = seconds_per_call([&] {
+      for (size_t i = 0; i < count; ++i) big_results[i] = big(i);
+    });
+    double fixed_seconds = seconds_per_call([&] {
+      for (size_t i = 0; i < count; ++i) fixed_results[i] = fixed(i);
+    });
+    bool same = true;
+    for (size_t i = 0; i < count; ++i) same = same && BigInteger(fixed_results[i]) == big_results[i];
+    std::printf("{\"benchmark\": \"fixed\", \"bits\": %zu, \"op\": \"%s\", \"ns_per_op\": %.1f, "
+                "\"fixed_ns_per_op\": %.1f, \"check\": \"%s\"}\n", Bits, op, seconds / count * 1e9,
+                fixed_seconds / count * 1e9, check(same));
+  };
+  report("add", [&](size_t i) { return a[i] + b[i]; }, [&](size_t i) { return fixed_a[i] + fixed_b[i]; });
+  report("sub", [&](size_t i) { return a[i] - b[i]; }, [&](size_t i) { return fixed_a[i] - fixed_b[i]; });
+  report("mul", [&](size_t i) { return a[i] * b[i]; }, [&](size_t i) { return fixed_a[i] * fixed_b[i]; });
+  report("div", [&](size_t i) { return wide[i] / b[i]; }, [&](size_t i) { return fixed_wide[i] / fixed_b[i]; });
+  report("mod", [&](size_t i) { return wide[i] % b[i]; }, [&](size_t i) { return fixed_wide[i] % fixed_b[i]; });
+}
+
+// FixedBigInt against BigInteger at the widths it is meant for, 128 to 1024 bits.
+void benchmark_fixed() {
+  std::mt19937_64 rng(37);
+  report_fixed<128>(rng);
+  report_fixed<256>(rng);
+  report_fixed<512>(rng);
+  report_fixed<1024>(rng);
+}
+
+// Writing a batch of values as text (operator<< with a newline after each) and reading it back
+// with operator>>, against BigIntegerWriter and BigIntegerReader on the binary format. Many
+// small values, a middle size, and a single value of about a million digits.
+void benchmark_serialization() {
+  std::mt19937_64 rng(38);
+  const std::pair<size_t, size_t> batches[] = {{100000, 2}, {10000, 100}, {1, 111112}};
+  for (auto [count, limbs] : batches) {
+    std::vector<BigInteger> values;
+    for (size_t i = 0; i < count; ++i) {
+      values.push_back(random_integer(rng, limbs));
+      if (rng() % 2) values.back() = -values.back();
+    }
+    std::string text, binary;
+    std::vector<BigInteger> text_values(count), binary_values(count);
+    double write_seconds = seconds_per_call([&] {
+      std::ostringstream out;
+      for (const BigInteger &x : values) out << x << '\n';
+      text = out.str();
+    });
+    double read_seconds = seconds_per_call([&] {
+      std::istringstream in(text);
+      for (BigInteger &x : text_values) in >> x;
+    });
+    double binary_write_seconds = seconds_per_call([&] {
+      std::ostringstream out;
+      BigIntegerWriter writer(out);
+      writer.write(values.begin(), values.end());
+      binary = out.str();
+    });
+    double binary_read_seconds = seconds_per_call([&] {
+      std::istringstream in(binary);
+      BigIntegerReader reader(in);
+      reader.read(binary_values.begin(), binary_values.end());
+    });
+    std::printf("{\"benchmark\": \"serialization\", \"count\": %zu, \"limbs\": %zu, \"text_bytes\": %zu, "
+                "\"write_seconds\": %.6e, \"read_seconds\": %.6e, \"binary_bytes\": %zu, \"binary_write_seconds\": %.6e, "
+                "\"binary_read_seconds\": %.6e, \"check\": \"%s\"}\n", count, limbs, text.size(), write_seconds,
+                read_seconds, binary.size(), binary_write_seconds, binary_read_seconds,
+                check(text_values == values && binary_values == values));
+  }
+}
+
+// 10^5! and 10^6! by the prime swing factorial and by product() over 1..n, which check each
+// other, and 10^5! by the left-to-right loop r *= i as well; at 10^6 that loop would take hours.
+void benchmark_factorial() {
+  for (unsigned n : {100000u, 1000000u}) {
+    std::vector<int> factors(n);
+    for (unsigned i = 0; i < n; ++i) factors[i] = int(i + 1);
+    BigInteger result, tree_result, naive_result;
+    double seconds = seconds_per_call([&] { result = factorial(n); });
+    double tree_seconds = seconds_per_call([&] { tree_result = product(factors.begin(), factors.end()); });
+    bool same = result == tree_result;
+    std::printf("{\"benchmark\": \"factorial\", \"n\": %u, \"digits\": %zu, \"seconds\": %.6e, "
+                "\"product_tree_seconds\": %.6e", n, result.length(), seconds, tree_seconds);
+    if (n <= 100000) {
+      double start = now();
+      naive_result = 1;
+      for (unsigned i = 2; i <= n; ++i) naive_result *= int(i);
+      std::printf(", \"naive_seconds\": %.6e", now() - start);
+      same = same && naive_result == result;
+    } else {
+      std::printf(", \"naive_seconds\": null");
+    }
+    std::printf(", \"check\": \"%s\"}\n", check(same));
+    std::fflush(stdout);
+  }
+}
+
+struct Benchmark {
+  const char *name;
+  void (*run)();
+};
+
+const Benchmark benchmarks[] = {
+    {"scaling", benchmark_scaling},
+    {"expression_chain", benchmark_expression_chain},
+    {"harmonic", benchmark_harmonic},
+    {"sort", benchmark_sort},
+    {"powmod", benchmark_powmod},
+    {"pow_roots", benchmark_pow_roots},
+    {"kernels", benchmark_kernels},
+    {"threads", benchmark_threads},
+    {"scratch", benchmark_scratch},
+    {"shifts", benchmark_shifts},
+    {"fixed", benchmark_fixed},
+    {"serialization", benchmark_serialization},
+    {"factorial", benchmark_factorial},
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc > 1 && std::strspn(argv[1], "0123456789") == std::strlen(argv[1])) {
+    run_scaling(std::strtoull(argv[1], nullptr, 10), argc > 2 ? std::atof(argv[2]) : 2.0);
+    return mismatches == 0 ? 0 : 1;
+  }
+  for (const Benchmark &benchmark : benchmarks) {
+    bool selected = argc == 1;
+    for (int i = 1; i < argc; ++i) {
+      selected = selected || std::strcmp(argv[i], benchmark.name) == 0;
+    }
+    if (selected) {
+      benchmark.run();
+      std::fflush(stdout);
+    }
+  }
+  return mismatches == 0 ? 0 : 1;
+}
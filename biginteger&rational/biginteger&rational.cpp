@@ -1,8 +1,557 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <future>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+// Limb kernels for base 10^9: every BigInteger carry chain goes through these. The loops are
+// branch-free (carries come from comparisons and division by a constant, never from `%` by a
+// variable). With GCC or Clang on x86-64 each kernel is also cloned for Haswell (AVX2, BMI2)
+// and the variant is picked at load time; other targets get the portable version only.
+#if defined(__x86_64__) && defined(__GNUC__) && defined(__linux__)
+#define BIGINTEGER_KERNEL __attribute__((target_clones("arch=haswell", "default")))
+#else
+#define BIGINTEGER_KERNEL
+#endif
+
+namespace biginteger_detail {
+
+constexpr int limb_base = 1000000000;
+
+// r = a + b over n limbs, returns the carry out.
+BIGINTEGER_KERNEL inline int add_n(int *r, const int *a, const int *b, size_t n) {
+  int carry = 0;
+  for (size_t i = 0; i < n; ++i) {
+    // The carry chain only depends on the previous carry through `propagate`, so the
+    // generate/propagate flags of later limbs are computed ahead of it.
+    int sum = a[i] + b[i];
+    int generate = sum >= limb_base;
+    int propagate = sum == limb_base - 1;
+    r[i] = sum + carry - ((generate | (propagate & carry)) ? limb_base : 0);
+    carry = generate | (propagate & carry);
+  }
+  return carry;
+}
+
+// r = a - b over n limbs, returns the borrow out.
+BIGINTEGER_KERNEL inline int sub_n(int *r, const int *a, const int *b, size_t n) {
+  int borrow = 0;
+  for (size_t i = 0; i < n; ++i) {
+    int diff = a[i] - b[i];
+    int generate = diff < 0;
+    int propagate = diff == 0;
+    r[i] = diff - borrow + ((generate | (propagate & borrow)) ? limb_base : 0);
+    borrow = generate | (propagate & borrow);
+  }
+  return borrow;
+}
+
+// The multiply kernels split every a[i] * x into a high and a low limb before touching the carry,
+// so the division by the base stays off the carry chain; what runs as a chain is one addition
+// and a comparison per limb. The high limb is at most base - 2, so high + carry fits a limb.
+
+// r = a * x over n limbs for 0 <= x < base, returns the high limb.
+BIGINTEGER_KERNEL inline int mul_1(int *r, const int *a, size_t n, int x) {
+  int carry = 0;
+  for (size_t i = 0; i < n; ++i) {
+    long long product = 1ll * a[i] * x;
+    long long high = product / limb_base;
+    int sum = int(product - high * limb_base) + carry;
+    int over = sum >= limb_base;
+    r[i] = sum - (over ? limb_base : 0);
+    carry = int(high) + over;
+  }
+  return carry;
+}
+
+// r += a * x over n limbs for 0 <= x < base, returns the high limb.
+BIGINTEGER_KERNEL inline int addmul_1(int *r, const int *a, size_t n, int x) {
+  int carry = 0;
+  for (size_t i = 0; i < n; ++i) {
+    long long product = 1ll * a[i] * x;
+    long long high = product / limb_base;
+    int low = int(product - high * limb_base) + r[i];
+    int low_over = low >= limb_base;
+    low -= low_over ? limb_base : 0;
+    int sum = low + carry;
+    int over = sum >= limb_base;
+    r[i] = sum - (over ? limb_base : 0);
+    carry = int(high) + low_over + over;
+  }
+  return carry;
+}
+
+// r -= a * x over n limbs for 0 <= x < base, returns the limb to subtract from r[n].
+BIGINTEGER_KERNEL inline int submul_1(int *r, const int *a, size_t n, int x) {
+  int carry = 0;
+  for (size_t i = 0; i < n; ++i) {
+    long long product = 1ll * a[i] * x;
+    long long high = product / limb_base;
+    int low = r[i] - int(product - high * limb_base);
+    int low_borrow = low < 0;
+    low += low_borrow ? limb_base : 0;
+    int diff = low - carry;
+    int borrow = diff < 0;
+    r[i] = diff + (borrow ? limb_base : 0);
+    carry = int(high) + low_borrow + borrow;
+  }
+  return carry;
+}
+
+// r = a / x over n limbs for 0 < x < base (most significant limb first), returns the remainder.
+BIGINTEGER_KERNEL inline int divrem_1(int *r, const int *a, size_t n, int x) {
+  long long rest = 0;
+  for (size_t i = n; i > 0; --i) {
+    long long curr = rest * limb_base + a[i - 1];
+    long long q = curr / x;
+    rest = curr - q * x;
+    r[i - 1] = int(q);
+  }
+  return int(rest);
+}
+
+// r = a * 2^s over n limbs for 0 < s < 30, returns the high limb. The split of every a[i] * 2^s
+// into a low limb and a small high part is independent of its neighbours; only the 0/1 carry of
+// adding the neighbour's high part runs as a chain, resolved as in add_n.
+BIGINTEGER_KERNEL inline int lshift_1(int *r, const int *a, size_t n, int s) {
+  int high = 0;
+  int carry = 0;
+  for (size_t i = 0; i < n; ++i) {
+    unsigned long long curr = (unsigned long long) a[i] << s;
+    unsigned long long q = curr / limb_base;
+    int sum = int(curr - q * limb_base) + high;
+    int generate = sum >= limb_base;
+    int propagate = sum == limb_base - 1;
+    r[i] = sum + carry - ((generate | (propagate & carry)) ? limb_base : 0);
+    carry = generate | (propagate & carry);
+    high = int(q);
+  }
+  return high + carry;
+}
+
+// r = a / 2^s over n limbs for 0 < s < 30, returns the s bits shifted out. Dividing by a power
+// of two needs only a shift and a mask where divrem_1 pays for a full division per limb.
+BIGINTEGER_KERNEL inline int rshift_1(int *r, const int *a, size_t n, int s) {
+  unsigned long long rest = 0;
+  unsigned long long mask = (1ull << s) - 1;
+  for (size_t i = n; i > 0; --i) {
+    unsigned long long curr = rest * limb_base + a[i - 1];
+    r[i - 1] = int(curr >> s);
+    rest = curr & mask;
+  }
+  return int(rest);
+}
+
+// Propagates a carry (or borrow) of 0 or 1 through r[0..n); returns what falls out of the top.
+inline int add_1(int *r, size_t n, int carry) {
+  for (size_t i = 0; i < n && carry; ++i) {
+    carry = ++r[i] == limb_base;
+    if (carry) r[i] = 0;
+  }
+  return carry;
+}
+
+inline int sub_1(int *r, size_t n, int borrow) {
+  for (size_t i = 0; i < n && borrow; ++i) {
+    borrow = --r[i] < 0;
+    if (borrow) r[i] = limb_base - 1;
+  }
+  return borrow;
+}
+
+// r[0..n) += x for 0 <= x < base; returns the carry out of the top.
+inline int add_limb(int *r, size_t n, int x) {
+  if (n == 0) return x;
+  r[0] += x;
+  if (r[0] < limb_base) return 0;
+  r[0] -= limb_base;
+  return add_1(r + 1, n - 1, 1);
+}
+
+// 64-bit words (least significant first) of the n decimal limbs at `limbs`, by Horner's rule on
+// the words with two limbs (a factor of 10^18) per pass; zero gives no words. Quadratic.
+inline void to_binary(const int *limbs, size_t n, std::vector<uint64_t> &words) {
+  words.clear();
+  for (size_t i = n; i > 0;) {
+    uint64_t factor = limb_base;
+    uint64_t carry = uint64_t(limbs[--i]);
+    if (i % 2 == 1) {
+      factor *= limb_base;
+      carry = carry * limb_base + uint64_t(limbs[--i]);
+    }
+    for (uint64_t &word : words) {
+      unsigned __int128 curr = (unsigned __int128) word * factor + carry;
+      word = uint64_t(curr);
+      carry = uint64_t(curr >> 64);
+    }
+    if (carry) words.push_back(carry);
+  }
+}
+
+// The inverse of to_binary: every word enters the limbs as two 32-bit halves.
+inline void from_binary(const uint64_t *words, size_t n, std::vector<int> &limbs) {
+  limbs.assign(1, 0);
+  for (size_t i = n; i > 0; --i) {
+    for (uint64_t half : {words[i - 1] >> 32, words[i - 1] & 0xffffffffu}) {
+      uint64_t carry = half;
+      for (int &limb : limbs) {
+        uint64_t curr = (uint64_t(limb) << 32) + carry;
+        carry = curr / limb_base;
+        limb = int(curr - carry * limb_base);
+      }
+      for (; carry; carry /= limb_base) {
+        limbs.push_back(int(carry % limb_base));
+      }
+    }
+  }
+}
+
+// Per-thread scratch memory for intermediate limbs. Raw limb spans are bumped out of a list of
+// chunks and vector temporaries are lent from a pool, so that the vector helpers keep working;
+// ScratchScope hands both back in LIFO order. When the outermost scope of an operation closes
+// the region is reset, and anything above `retained_limbs` is returned to the allocator unless
+// a BigIntegerScratch context pins the arena.
+class ScratchArena {
+ public:
+  struct Mark {
+    size_t chunk;
+    size_t used;
+    size_t vectors;
+  };
+
+  static ScratchArena &local() {
+    thread_local ScratchArena arena;
+    return arena;
+  }
+
+  int *allocate(size_t n) {
+    while (chunk < chunks.size() && used + n > chunk_sizes[chunk]) {
+      ++chunk;
+      used = 0;
+    }
+    if (chunk == chunks.size()) {
+      size_t size = std::max(n, min_chunk_limbs);
+      if (!chunk_sizes.empty()) size = std::max(size, 2 * chunk_sizes.back());
+      chunks.emplace_back(new int[size]);
+      chunk_sizes.push_back(size);
+      used = 0;
+    }
+    int *result = chunks[chunk].get() + used;
+    used += n;
+    return result;
+  }
+
+  std::vector<int> &vector() {
+    if (vectors == pool.size()) pool.emplace_back(new std::vector<int>);
+    std::vector<int> &result = *pool[vectors++];
+    result.clear();
+    return result;
+  }
+
+  Mark mark() const {
+    return {chunk, used, vectors};
+  }
+
+  void release(const Mark &mark) {
+    chunk = mark.chunk;
+    used = mark.used;
+    vectors = mark.vectors;
+  }
+
+  void enter() {
+    ++depth;
+  }
+
+  void leave() {
+    if (--depth == 0 && pins == 0) shrink();
+  }
+
+  void pin(size_t reserve_limbs) {
+    ++pins;
+    if (reserve_limbs) {
+      Mark start = mark();
+      allocate(reserve_limbs);
+      release(start);
+    }
+  }
+
+  void unpin() {
+    if (--pins == 0 && depth == 0) shrink();
+  }
+
+ private:
+  static constexpr size_t min_chunk_limbs = 1 << 12;
+  static constexpr size_t retained_limbs = 1 << 16;
+  std::vector<std::unique_ptr<int[]>> chunks;
+  std::vector<size_t> chunk_sizes;
+  std::vector<std::unique_ptr<std::vector<int>>> pool;
+  size_t chunk = 0;
+  size_t used = 0;
+  size_t vectors = 0;
+  size_t depth = 0;
+  size_t pins = 0;
+
+  // Only runs when nothing is borrowed.
+  void shrink() {
+    size_t total = 0;
+    for (size_t size : chunk_sizes) total += size;
+    for (const auto &v : pool) total += v->capacity();
+    if (total <= retained_limbs) return;
+    chunks.clear();
+    chunk_sizes.clear();
+    pool.clear();
+  }
+};
+
+class ScratchScope {
+ public:
+  ScratchScope() : arena(ScratchArena::local()), start(arena.mark()) {
+    arena.enter();
+  }
+
+  ScratchScope(const ScratchScope &) = delete;
+  ScratchScope &operator=(const ScratchScope &) = delete;
+
+  ~ScratchScope() {
+    arena.release(start);
+    arena.leave();
+  }
+
+  // Uninitialized limbs valid until the scope closes.
+  int *limbs(size_t n) {
+    return arena.allocate(n);
+  }
+
+  // An empty vector whose capacity survives from earlier operations.
+  std::vector<int> &vector() {
+    return arena.vector();
+  }
+
+ private:
+  ScratchArena &arena;
+  ScratchArena::Mark start;
+};
+
+constexpr size_t karatsuba_limbs = 40;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+constexpr bool little_endian = true;
+#else
+constexpr bool little_endian = false;
+#endif
+
+inline size_t varint_size(uint64_t x) {
+  size_t size = 1;
+  for (; x >= 0x80; x >>= 7) ++size;
+  return size;
+}
+
+// LEB128: seven bits per byte, least significant first, the high bit marks a continuation.
+inline unsigned char *put_varint(unsigned char *out, uint64_t x) {
+  for (; x >= 0x80; x >>= 7) *out++ = (unsigned char) (x | 0x80);
+  *out++ = (unsigned char) x;
+  return out;
+}
+
+// The primes up to n, from a sieve over the odd numbers.
+inline std::vector<unsigned> primes_up_to(unsigned n) {
+  std::vector<unsigned> primes;
+  if (n < 2) return primes;
+  primes.push_back(2);
+  std::vector<bool> composite(n / 2 + 1);  // entry i stands for 2i + 1
+  for (unsigned long long i = 1; 2 * i + 1 <= n; ++i) {
+    if (composite[i]) continue;
+    unsigned long long p = 2 * i + 1;
+    primes.push_back(unsigned(p));
+    for (unsigned long long j = p * p / 2; 2 * j + 1 <= n; j += p) composite[j] = true;
+  }
+  return primes;
+}
+
+// Multiplies small factors together into 64-bit words, starting a new word whenever the next
+// factor would overflow the current one, so a product tree gets a few full leaves instead of
+// many tiny ones.
+struct FactorWords {
+  std::vector<unsigned long long> words;
+  unsigned long long current = 1;
+
+  void push(unsigned long long factor) {
+    if (current > std::numeric_limits<unsigned long long>::max() / factor) {
+      words.push_back(current);
+      current = 1;
+    }
+    current *= factor;
+  }
+
+  const std::vector<unsigned long long> &finish() {
+    if (current > 1) words.push_back(current);
+    current = 1;
+    return words;
+  }
+};
+
+// r[0..na+nb) = a * b
+inline void mul_basecase(int *r, const int *a, size_t na, const int *b, size_t nb) {
+  std::fill(r, r + na + nb, 0);
+  for (size_t i = 0; i < na; ++i) {
+    r[i + nb] = addmul_1(r + i, b, nb, a[i]);
+  }
+}
+
+// r[0..2n) = a * a; every cross product a[i] * a[j] is computed once and doubled.
+inline void sqr_basecase(int *r, const int *a, size_t n) {
+  std::fill(r, r + 2 * n, 0);
+  for (size_t i = 0; i + 1 < n; ++i) {
+    r[i + n] = addmul_1(r + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+  }
+  add_n(r, r, r, 2 * n);
+  long long add = 0;
+  for (size_t i = 0; i < n; ++i) {
+    long long curr = 1ll * a[i] * a[i] + r[2 * i] + add;
+    add = curr / limb_base;
+    r[2 * i] = int(curr - add * limb_base);
+    curr = r[2 * i + 1] + add;
+    add = curr / limb_base;
+    r[2 * i + 1] = int(curr - add * limb_base);
+  }
+}
+
+// r[0..na+nb) = a * b by Karatsuba (a == b with na == nb squares). Nodes of at least
+// `parallel_limbs` limbs hand two of their three subproducts to other threads while more than
+// one thread of the `threads` budget is left; the limbs produced do not depend on the split.
+inline void mul_recursive(int *r, const int *a, size_t na, const int *b, size_t nb,
+                          unsigned threads, size_t parallel_limbs) {
+  bool same = a == b && na == nb;
+  if (na < nb) {
+    std::swap(a, b);
+    std::swap(na, nb);
+  }
+  if (nb < karatsuba_limbs) {
+    if (same) {
+      sqr_basecase(r, a, na);
+    } else {
+      mul_basecase(r, a, na, b, nb);
+    }
+    return;
+  }
+  size_t h = (na + 1) / 2;
+  bool parallel = threads > 1 && nb >= parallel_limbs;
+  if (nb <= h) {
+    // Unbalanced operands: multiply b by nb-limb slices of a and add the partial products.
+    size_t chunks = (na + nb - 1) / nb;
+    std::fill(r, r + na + nb, 0);
+    ScratchScope scratch;
+    int *parts = scratch.limbs((parallel ? chunks : 1) * 2 * nb);
+    auto part_size = [&](size_t c) { return std::min(nb, na - c * nb) + nb; };
+    auto slice = [&](size_t c, int *part) {
+      mul_recursive(part, a + c * nb, part_size(c) - nb, b, nb, 1, parallel_limbs);
+    };
+    auto accumulate = [&](size_t c, const int *part) {
+      size_t offset = c * nb;
+      size_t size = part_size(c);
+      int carry = add_n(r + offset, r + offset, part, size);
+      add_1(r + offset + size, na + nb - offset - size, carry);
+    };
+    if (parallel) {
+      std::vector<std::future<void>> tasks;
+      unsigned workers = std::min<size_t>(threads, chunks);
+      for (unsigned w = 0; w < workers; ++w) {
+        tasks.push_back(std::async(std::launch::async, [&, w] {
+          for (size_t c = w; c < chunks; c += workers) slice(c, parts + c * 2 * nb);
+        }));
+      }
+      for (auto &task : tasks) task.get();
+      for (size_t c = 0; c < chunks; ++c) accumulate(c, parts + c * 2 * nb);
+    } else {
+      for (size_t c = 0; c < chunks; ++c) {
+        slice(c, parts);
+        accumulate(c, parts);
+      }
+    }
+    return;
+  }
+  size_t high_a = na - h;
+  size_t high_b = nb - h;
+  ScratchScope scratch;
+  int *sum_a = scratch.limbs(h + 1);
+  int carry_a = add_n(sum_a, a, a + h, high_a);
+  std::copy(a + high_a, a + h, sum_a + high_a);
+  sum_a[h] = add_1(sum_a + high_a, h - high_a, carry_a);
+  int *sum_b = sum_a;
+  if (!same) {
+    sum_b = scratch.limbs(h + 1);
+    int carry = add_n(sum_b, b, b + h, high_b);
+    std::copy(b + high_b, b + h, sum_b + high_b);
+    sum_b[h] = add_1(sum_b + high_b, h - high_b, carry);
+  }
+  size_t middle_size = 2 * h + 2;
+  int *middle = scratch.limbs(middle_size);
+  unsigned child = std::max(1u, threads / 3);
+  auto low_part = [&] { mul_recursive(r, a, h, same ? a : b, h, child, parallel_limbs); };
+  auto high_part = [&] {
+    mul_recursive(r + 2 * h, a + h, high_a, same ? a + h : b + h, same ? high_a : high_b, child,
+                  parallel_limbs);
+  };
+  auto middle_part = [&](unsigned budget) {
+    mul_recursive(middle, sum_a, h + 1, sum_b, h + 1, budget, parallel_limbs);
+  };
+  if (parallel) {
+    auto low = std::async(std::launch::async, low_part);
+    auto high = std::async(std::launch::async, high_part);
+    middle_part(std::max(1u, threads - 2 * child));
+    low.get();
+    high.get();
+  } else {
+    low_part();
+    high_part();
+    middle_part(1);
+  }
+  int borrow = sub_n(middle, middle, r, 2 * h);
+  sub_1(middle + 2 * h, 2, borrow);
+  size_t high_size = high_a + high_b;
+  borrow = sub_n(middle, middle, r + 2 * h, high_size);
+  sub_1(middle + high_size, middle_size - high_size, borrow);
+  size_t room = na + nb - h;
+  size_t used = std::min(middle_size, room);
+  int carry = add_n(r + h, r + h, middle, used);
+  add_1(r + h + used, room - used, carry);
+}
+
+}  // namespace biginteger_detail
+
+// Keeps the calling thread's scratch memory for BigInteger and Rational temporaries alive while
+// the object exists, optionally reserving `reserve_limbs` limbs up front, so that a loop of
+// operations stops going back to the allocator after its first iteration.
+class BigIntegerScratch {
+ public:
+  explicit BigIntegerScratch(size_t reserve_limbs = 0) : arena(biginteger_detail::ScratchArena::local()) {
+    arena.pin(reserve_limbs);
+  }
+
+  BigIntegerScratch(const BigIntegerScratch &) = delete;
+  BigIntegerScratch &operator=(const BigIntegerScratch &) = delete;
+
+  ~BigIntegerScratch() {
+    arena.unpin();
+  }
+
+ private:
+  biginteger_detail::ScratchArena &arena;
+};
+
+template<size_t Bits>
+class FixedBigInt;
+
 class BigInteger {
  public:
 
@@ -28,20 +577,56 @@ class BigInteger {
     sign = another.sign;
   }
 
+  // Leaves `another` without limbs rather than allocating a zero for it. A moved-from value
+  // compares, prints and measures as 0 and can be assigned to; other operations need it
+  // assigned first.
+  BigInteger(BigInteger &&another) noexcept : number(std::move(another.number)), sign(another.sign) {
+    another.sign = true;
+  }
+
   ~BigInteger() = default;
 
+  void swap(BigInteger &another) noexcept {
+    number.swap(another.number);
+    std::swap(sign, another.sign);
+  }
+
   BigInteger &operator=(const BigInteger &another) {
     number = another.number;
     sign = another.sign;
     return *this;
   }
 
-  BigInteger operator-() const {
+  // Keeps the allocated limbs, unlike going through BigInteger(int) and the move assignment.
+  BigInteger &operator=(int x) {
+    long long value = x;
+    sign = value >= 0;
+    if (value < 0) value = -value;
+    number.assign(1, int(value % base));
+    if (value >= base) number.push_back(int(value / base));
+    return *this;
+  }
+
+  BigInteger &operator=(BigInteger &&another) noexcept {
+    if (this != &another) {
+      number.swap(another.number);
+      sign = another.sign;
+      another.sign = true;
+    }
+    return *this;
+  }
+
+  BigInteger operator-() const & {
     BigInteger result = *this;
     result.flip_sign();
     return result;
   }
 
+  BigInteger operator-() && {
+    flip_sign();
+    return std::move(*this);
+  }
+
   BigInteger &operator++() {
     return *this += 1;
   }
@@ -53,7 +638,8 @@ class BigInteger {
   }
 
   bool operator==(const BigInteger &another) const {
-    if (number.size() != another.number.size()) return false;
+    if (number.empty() || another.number.empty()) return is_zero() && another.is_zero();
+    if (sign != another.sign || number.size() != another.number.size()) return false;
     for (size_t i = 0; i < number.size(); ++i) {
       if (number[i] != another.number[i]) return false;
     }
@@ -61,7 +647,7 @@ class BigInteger {
   }
 
   bool operator==(int x) const {
-    return *this == BigInteger(x);
+    return compare(x) == 0;
   }
 
   bool operator!=(const BigInteger &another) const {
@@ -69,10 +655,11 @@ class BigInteger {
   }
 
   bool operator!=(int x) const {
-    return *this != BigInteger(x);
+    return compare(x) != 0;
   }
 
   bool operator<(const BigInteger &another) const {
+    if (number.empty() || another.number.empty()) return is_zero() ? another.signum() > 0 : !sign;
     if (sign != another.sign) return another.sign;
     if (number.size() != another.number.size()) return (number.size() < another.number.size()) ^ !sign;
     for (int64_t i = number.size() - 1; i > -1; --i) {
@@ -82,7 +669,7 @@ class BigInteger {
   }
 
   bool operator<(int x) const {
-    return *this < BigInteger(x);
+    return compare(x) < 0;
   }
 
   bool operator>(const BigInteger &another) const {
@@ -90,7 +677,7 @@ class BigInteger {
   }
 
   bool operator>(int x) const {
-    return *this > BigInteger(x);
+    return compare(x) > 0;
   }
 
   bool operator>=(const BigInteger &another) const {
@@ -98,7 +685,7 @@ class BigInteger {
   }
 
   bool operator>=(int x) const {
-    return *this >= BigInteger(x);
+    return compare(x) >= 0;
   }
 
   bool operator<=(const BigInteger &another) const {
@@ -106,30 +693,16 @@ class BigInteger {
   }
 
   bool operator<=(int x) const {
-    return *this <= BigInteger(x);
+    return compare(x) <= 0;
   }
 
   BigInteger &operator+=(const BigInteger &another) {
     if (sign == another.sign) {
-      size_t max_size = std::max(number.size(), another.number.size());
-      while (number.size() <= max_size + 1) {
-        number.push_back(0);
-      }
-      for (size_t i = 0; i < another.number.size() || number[i] >= base; ++i) {
-        if (i < another.number.size()) {
-          number[i] += another.number[i];
-        }
-        if (number[i] >= base) {
-          number[i] %= base;
-          ++number[i + 1];
-        }
-      }
-      fix_this();
-    } else {
-      sign = !sign;
-      *this -= another;
+      add_abs(number, another.number);
+    } else if (sub_abs(number, another.number)) {
       sign = !sign;
     }
+    fix_this();
     return *this;
   }
 
@@ -138,39 +711,12 @@ class BigInteger {
   }
 
   BigInteger &operator-=(const BigInteger &another) {
-    if (sign == another.sign) {
-      size_t max_size = std::max(number.size(), another.number.size());
-      while (number.size() <= max_size + 1) {
-        number.push_back(0);
-      }
-      for (size_t i = 0; (i < another.number.size() || number[i] < 0) && i < number.size() - 1; ++i) {
-        if (i < another.number.size()) {
-          number[i] -= another.number[i];
-        }
-        if (number[i] < 0) {
-          number[i] += base;
-          --number[i + 1];
-        }
-      }
-      fix_this();
-      if (number.back() < 0) {
-        sign = !sign;
-        for (size_t i = 0; i < number.size(); ++i) {
-          number[i] = -number[i];
-        }
-        for (size_t i = 0; i < number.size() - 1; ++i) {
-          if (number[i] < 0) {
-            number[i] += base;
-            --number[i + 1];
-          }
-        }
-      }
-      fix_this();
-    } else {
-      sign = !sign;
-      *this += another;
+    if (sign != another.sign) {
+      add_abs(number, another.number);
+    } else if (sub_abs(number, another.number)) {
       sign = !sign;
     }
+    fix_this();
     return *this;
   }
 
@@ -178,101 +724,130 @@ class BigInteger {
     return *this -= BigInteger(x);
   }
 
-  BigInteger operator+(const BigInteger &another) const {
+  BigInteger operator+(const BigInteger &another) const & {
     BigInteger result = *this;
     return result += another;
   }
 
-  BigInteger operator+(int x) const {
+  BigInteger operator+(const BigInteger &another) && {
+    return std::move(*this += another);
+  }
+
+  BigInteger operator+(BigInteger &&another) && {
+    if (another.number.capacity() > number.capacity()) {
+      return std::move(another += *this);
+    }
+    return std::move(*this += another);
+  }
+
+  BigInteger operator+(int x) const & {
     BigInteger result = *this;
     return result += x;
   }
 
-  BigInteger operator-(const BigInteger &another) const {
+  BigInteger operator+(int x) && {
+    return std::move(*this += x);
+  }
+
+  BigInteger operator-(const BigInteger &another) const & {
     BigInteger result = *this;
     return result -= another;
   }
 
-  BigInteger operator-(int x) const {
+  BigInteger operator-(const BigInteger &another) && {
+    return std::move(*this -= another);
+  }
+
+  BigInteger operator-(BigInteger &&another) && {
+    return std::move(*this -= another);
+  }
+
+  BigInteger operator-(int x) const & {
     BigInteger result = *this;
     return result -= x;
   }
 
+  BigInteger operator-(int x) && {
+    return std::move(*this -= x);
+  }
+
   BigInteger &operator*=(int x) {
-    number.push_back(0);
+    if (x <= -base || x >= base) {
+      return *this *= BigInteger(x);
+    }
     if (x < 0) {
       sign = !sign;
       x = -x;
     }
-    int add = 0;
-    for (size_t i = 0; i < number.size(); ++i) {
-      long long curr = add + 1ll * number[i] * x;
-      number[i] = curr % base;
-      add = curr / base;
-    }
+    mul_small(number, x);
     fix_this();
     return *this;
   }
 
-  BigInteger operator*(int x) const {
+  BigInteger operator*(int x) const & {
     BigInteger result = *this;
     return (result *= x);
   }
 
-  BigInteger operator*(const BigInteger &another) const {
+  BigInteger operator*(int x) && {
+    return std::move(*this *= x);
+  }
+
+  BigInteger operator*(const BigInteger &another) const & {
     BigInteger result;
-    result.number.resize(number.size() + another.number.size());
-    for (size_t i = 0; i < number.size(); ++i) {
-      int add = 0;
-      for (size_t j = 0; j < another.number.size() || add; ++j) {
-        long long curr = result.number[i + j] + add;
-        if (j < another.number.size()) {
-          curr += 1ll * number[i] * another.number[j];
-        }
-        result.number[i + j] = curr % base;
-        add = curr / base;
-      }
-    }
+    multiply(result.number, number, another.number);
     result.sign = sign == another.sign;
     result.fix_this();
     return result;
   }
 
+  BigInteger operator*(const BigInteger &another) && {
+    return std::move(*this *= another);
+  }
+
+  BigInteger operator*(BigInteger &&another) && {
+    return std::move(*this *= another);
+  }
+
   BigInteger &operator*=(const BigInteger &another) {
-    return *this = *this * another;
-  }
-
-  BigInteger operator/(const BigInteger &another) const {
-    BigInteger mod = *this;
-    mod.sign = another.sign;
-    BigInteger result = 0;
-    while ((another.sign ? mod >= another : mod <= another)) {
-      size_t sub_length = mod.length() - another.length();
-      if (sub_length == 0) {
-        result += 1;
-        mod -= another;
-      } else {
-        BigInteger curr = 1;
-        curr = curr.addition_pow(sub_length - 1);
-        BigInteger curr_add_another = another.addition_pow(sub_length - 1);
-        int mod_curr = (mod.front_digit() <= another.front_digit() ? 1 : 10);
-        curr *= mod_curr;
-        curr_add_another *= mod_curr;
-        mod -= curr_add_another;
-        result += curr;
-      }
-    }
+    biginteger_detail::ScratchScope scratch;
+    std::vector<int> &result = scratch.vector();
+    multiply(result, number, another.number);
+    number.swap(result);
+    sign = sign == another.sign;
+    fix_this();
+    return *this;
+  }
+
+  BigInteger operator/(const BigInteger &another) const & {
+    BigInteger result;
+    biginteger_detail::ScratchScope scratch;
+    divmod(number, another.number, result.number, scratch.vector());
     result.sign = (sign == another.sign);
     result.fix_this();
     return result;
   }
 
-  BigInteger operator/(int x) const {
+  BigInteger operator/(const BigInteger &another) && {
+    return std::move(*this /= another);
+  }
+
+  BigInteger operator/(int x) const & {
     return (*this) / BigInteger(x);
   }
 
+  BigInteger operator/(int x) && {
+    return std::move(*this /= x);
+  }
+
   BigInteger &operator/=(const BigInteger &another) {
-    return *this = *this / another;
+    biginteger_detail::ScratchScope scratch;
+    std::vector<int> &quotient = scratch.vector();
+    divmod(number, another.number, quotient, scratch.vector());
+    number.assign(quotient.begin(), quotient.end());
+    sign = (sign == another.sign);
+    fix_this();
+    return *this;
   }
 
   BigInteger &operator/=(int x) {
@@ -280,27 +855,190 @@ class BigInteger {
   }
 
   BigInteger &operator%=(const BigInteger &another) {
-    return *this -= *this / another * another;
+    biginteger_detail::ScratchScope scratch;
+    std::vector<int> &mod = scratch.vector();
+    divmod(number, another.number, scratch.vector(), mod);
+    number.assign(mod.begin(), mod.end());
+    fix_this();
+    return *this;
+  }
+
+  BigInteger operator%(const BigInteger &another) const & {
+    BigInteger result;
+    biginteger_detail::ScratchScope scratch;
+    divmod(number, another.number, scratch.vector(), result.number);
+    result.sign = sign;
+    result.fix_this();
+    return result;
+  }
+
+  BigInteger operator%(const BigInteger &another) && {
+    return std::move(*this %= another);
+  }
+
+  // Shifts and bitwise operators act on the two's complement form of the value, sign-extended
+  // to infinity: x << k is x * 2^k and x >> k is floor(x / 2^k).
+  BigInteger &operator<<=(size_t shift) {
+    if (!*this || shift == 0) return *this;
+    if (shift >= shift_multiply_bits) {
+      return *this *= power_of_two(shift);
+    }
+    number.reserve(number.size() + shift / shift_step_bits + 1);
+    while (shift > 0) {
+      int step = int(std::min<size_t>(shift, shift_step_bits));
+      int high = biginteger_detail::lshift_1(number.data(), number.data(), number.size(), step);
+      if (high) number.push_back(high);
+      shift -= step;
+    }
+    return *this;
+  }
+
+  BigInteger operator<<(size_t shift) const & {
+    BigInteger result = *this;
+    return result <<= shift;
+  }
+
+  BigInteger operator<<(size_t shift) && {
+    return std::move(*this <<= shift);
+  }
+
+  BigInteger &operator>>=(size_t shift) {
+    if (!*this || shift == 0) return *this;
+    bool inexact = false;
+    if (shift >= shift_divide_bits) {
+      biginteger_detail::ScratchScope scratch;
+      std::vector<int> &quotient = scratch.vector();
+      std::vector<int> &mod = scratch.vector();
+      divmod(number, power_of_two(shift).number, quotient, mod);
+      number.assign(quotient.begin(), quotient.end());
+      inexact = mod.size() > 1 || mod[0] != 0;
+    } else {
+      while (shift > 0 && (number.size() > 1 || number[0] != 0)) {
+        int step = int(std::min<size_t>(shift, shift_step_bits));
+        inexact |= biginteger_detail::rshift_1(number.data(), number.data(), number.size(), step) != 0;
+        trim(number);
+        shift -= step;
+      }
+    }
+    // Truncation rounded a negative value up; floor needs one more.
+    if (!sign && inexact && biginteger_detail::add_1(number.data(), number.size(), 1)) {
+      number.push_back(1);
+    }
+    fix_this();
+    return *this;
+  }
+
+  BigInteger operator>>(size_t shift) const & {
+    BigInteger result = *this;
+    return result >>= shift;
+  }
+
+  BigInteger operator>>(size_t shift) && {
+    return std::move(*this >>= shift);
+  }
+
+  // &, | and ^ convert both operands to 64-bit words and back: quadratic one way, divide and
+  // conquer over the decimal multiplication the other. Shifts and test_bit stay decimal.
+  // A nonnegative operand of & with m bits limits the result to bits below m, which only depend
+  // on the lowest m / 9 + 1 limbs of either operand (see test_bit), so only those are converted.
+  BigInteger &operator&=(const BigInteger &another) {
+    auto op = [](uint64_t x, uint64_t y) { return x & y; };
+    if (sign || another.sign) {
+      const size_t unbounded = std::numeric_limits<size_t>::max();
+      size_t bits = std::min(sign ? bit_length() : unbounded, another.sign ? another.bit_length() : unbounded);
+      size_t limbs = bits / 9 + 1;
+      if (number.size() > limbs) *this = low_limbs(limbs);
+      if (another.number.size() > limbs) {
+        bitwise(another.low_limbs(limbs), op);
+        return *this;
+      }
+    }
+    bitwise(another, op);
+    return *this;
+  }
+
+  BigInteger operator&(const BigInteger &another) const {
+    BigInteger result = *this;
+    return result &= another;
+  }
+
+  BigInteger &operator|=(const BigInteger &another) {
+    bitwise(another, [](uint64_t x, uint64_t y) { return x | y; });
+    return *this;
+  }
+
+  BigInteger operator|(const BigInteger &another) const {
+    BigInteger result = *this;
+    return result |= another;
   }
 
-  BigInteger operator%(const BigInteger &another) const {
+  BigInteger &operator^=(const BigInteger &another) {
+    bitwise(another, [](uint64_t x, uint64_t y) { return x ^ y; });
+    return *this;
+  }
+
+  BigInteger operator^(const BigInteger &another) const {
     BigInteger result = *this;
-    result -= *this / another * another;
+    return result ^= another;
+  }
+
+  // Bit k of the two's complement form, i.e. the parity of floor(x / 2^k). Limb i is a multiple
+  // of 10^(9i), hence of 2^(9i), so bits 0..k only depend on the lowest k / 9 + 1 limbs. Past
+  // the magnitude every bit is the sign.
+  bool test_bit(size_t k) const {
+    if (number.size() <= 2) {
+      long long value = (number.size() == 2 ? 1ll * number[1] * base : 0) + number[0];
+      return ((sign ? value : -value) >> std::min<size_t>(k, 63)) & 1;
+    }
+    size_t limbs = k / 9 + 1;
+    if (limbs >= number.size()) {
+      if (k >= bit_length()) return !sign;
+      return ((*this >> k).number[0] & 1) != 0;
+    }
+    return ((low_limbs(limbs) >>= k).number[0] & 1) != 0;
+  }
+
+  // Number of set bits in the absolute value.
+  size_t popcount() const {
+    std::vector<uint64_t> words;
+    biginteger_detail::to_binary(number.data(), number.size(), words);
+    size_t result = 0;
+    for (uint64_t word : words) {
+      result += __builtin_popcountll(word);
+    }
     return result;
   }
 
   std::string toString() const {
+    if (number.empty()) return "0";
     std::string result;
     if (!sign) {
       result.push_back('-');
     }
     result += tostring_num(number.back());
-    for (size_t i = number.size() - 1; i > 0; --i) {
-      int cnt_null = 9 - length_num(number[i - 1]);
-      for (int j = 0; j < cnt_null; ++j) {
-        result.push_back('0');
+    size_t head = result.size();
+    size_t n = number.size() - 1;
+    result.resize(head + 9 * n);
+    // Every lower limb fills its own 9 characters, so ranges of limbs are independent.
+    auto write = [&](size_t from, size_t to) {
+      for (size_t i = from; i < to; ++i) {
+        int limb = number[i];
+        char *out = &result[head + 9 * (n - i)];
+        for (int j = 0; j < 9; ++j) {
+          *--out = char('0' + limb % 10);
+          limb /= 10;
+        }
+      }
+    };
+    if (parallel_threads > 1 && n >= parallel_limbs) {
+      std::vector<std::future<void>> tasks;
+      size_t step = (n + parallel_threads - 1) / parallel_threads;
+      for (size_t from = 0; from < n; from += step) {
+        tasks.push_back(std::async(std::launch::async, write, from, std::min(n, from + step)));
       }
-      result += tostring_num(number[i - 1]);
+      for (auto &task : tasks) task.get();
+    } else {
+      write(0, n);
     }
     return result;
   }
@@ -313,7 +1051,7 @@ class BigInteger {
   }
 
   operator bool() const {
-    return (number.size() != 1 || number.front() != 0);
+    return !is_zero();
   }
 
   operator int() const {
@@ -335,114 +1073,1727 @@ class BigInteger {
     }
   }
 
-  void flip_sign() {
-    if (number.size() != 1 || number.front() != 0) sign = !sign;
+  void flip_sign() {
+    if (number.size() != 1 || number.front() != 0) sign = !sign;
+  }
+
+  BigInteger addition_pow(size_t x) const {
+    if (x == 0) return *this;
+    if (*this == 0) return *this;
+    BigInteger result;
+    result.sign = sign;
+    result.number.resize(x / 9);
+    for (size_t i = 0; i < number.size(); ++i) {
+      result.number.push_back(number[i]);
+    }
+    x %= 9;
+    int mod_pow = 1;
+    for (size_t i = 0; i < x; ++i) {
+      mod_pow *= 10;
+    }
+    result *= mod_pow;
+    return result;
+  }
+
+  void build_string(const std::string &s) {
+    number.clear();
+    sign = s.front() != '-';
+    size_t i = s.size() - 1;
+    while (i + 1 > 0 && s[i] != '-') {
+      number.push_back(0);
+      int pow = 1;
+      for (size_t j = 0; j < 9 && i + 1 > 0 && s[i] != '-'; ++j, --i) {
+        number.back() += pow * (s[i] - '0');
+        pow *= 10;
+      }
+    }
+  }
+
+  size_t length() const {
+    if (number.empty()) return 1;
+    return (number.size() - 1) * 9 + length_num(number.back());
+  }
+
+  // Lets multiplication, squaring, division and toString of operands with at least
+  // `threshold_limbs` limbs (9 decimal digits each) run on up to `threads` threads, as well as
+  // the subtrees of product() and factorial(); 0 threads means
+  // std::thread::hardware_concurrency(). Results do not depend on the setting.
+  static void set_parallelism(unsigned threads, size_t threshold_limbs = 2000) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    parallel_threads = threads;
+    parallel_limbs = std::max(threshold_limbs, biginteger_detail::karatsuba_limbs);
+  }
+
+  int signum() const {
+    if (!sign) return -1;
+    return is_zero() ? 0 : 1;
+  }
+
+  // Stores the value into `result` when it has at most two limbs (below 10^18 in magnitude).
+  bool to_int64(long long &result) const {
+    if (number.size() > 2) return false;
+    result = (number.size() == 2 ? 1ll * number[1] * base : 0) + number[0];
+    if (!sign) result = -result;
+    return true;
+  }
+
+  // Decimal logarithm of the absolute value estimated from the two leading limbs; -inf for zero.
+  double log10() const {
+    double top = number.back();
+    if (number.size() > 1) top = top * base + number[number.size() - 2];
+    size_t shift = number.size() > 1 ? number.size() - 2 : 0;
+    return std::log10(top) + 9.0 * shift;
+  }
+
+  // Number of bits of the absolute value. The three leading limbs T put |x| in
+  // [T, T + 1) * base^(size - 3), which fixes floor(log2 |x|) unless it lies within rounding of
+  // an integer, i.e. |x| is next to a power of two; only then is it compared against that power.
+  size_t bit_length() const {
+    if (!*this) return 0;
+    size_t size = number.size();
+    if (size <= 2) {
+      long long value = (size == 2 ? 1ll * number[1] * base : 0) + number[0];
+      return 64 - __builtin_clzll(value);
+    }
+    long double top = (1.0L * number[size - 1] * base + number[size - 2]) * base + number[size - 3];
+    long double estimate = std::log2(top) + (size - 3) * 29.897352853986261131L;  // log2(10^9)
+    long double margin = 1e-12L * estimate + 1e-9L;
+    size_t low = size_t(estimate - margin), high = size_t(estimate + margin);
+    if (low == high) return low + 1;
+    return compare_abs(number, power_of_two(high).number) < 0 ? high : high + 1;
+  }
+
+  // Binary record (format version 1): a varint of limb count * 2 + (negative ? 1 : 0), then the
+  // base 10^9 limbs as 4-byte little-endian words, least significant first. The limbs are the
+  // in-memory ones, so writing and reading are a copy with no base conversion.
+  static constexpr unsigned char binary_format_version = 1;
+
+  size_t encoded_size() const {
+    return biginteger_detail::varint_size(record_header()) + 4 * number.size();
+  }
+
+  // Writes the record to `out`, which must hold encoded_size() bytes; returns the end.
+  unsigned char *encode(unsigned char *out) const {
+    out = biginteger_detail::put_varint(out, record_header());
+    if (biginteger_detail::little_endian) {
+      std::memcpy(out, number.data(), 4 * number.size());
+      return out + 4 * number.size();
+    }
+    for (int limb : number) {
+      for (int shift = 0; shift < 32; shift += 8) *out++ = (unsigned char) (uint32_t(limb) >> shift);
+    }
+    return out;
+  }
+
+  // Reads one record from [begin, end) into this number, reusing its storage; returns the end
+  // of the record. Truncated or malformed input throws std::invalid_argument.
+  const unsigned char *decode(const unsigned char *begin, const unsigned char *end) {
+    uint64_t header = 0;
+    for (int shift = 0;; shift += 7) {
+      if (begin == end || shift > 63) throw std::invalid_argument("malformed BigInteger record");
+      unsigned char byte = *begin++;
+      header |= uint64_t(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) break;
+    }
+    uint64_t count = header >> 1;
+    if (count > uint64_t(end - begin) / 4) throw std::invalid_argument("truncated BigInteger record");
+    load_limbs(begin, count, (header & 1) != 0);
+    return begin + 4 * count;
+  }
+
+  void write_binary(std::ostream &out) const {
+    unsigned char header[10];
+    out.write((const char *) header, biginteger_detail::put_varint(header, record_header()) - header);
+    if (biginteger_detail::little_endian) {
+      out.write((const char *) number.data(), std::streamsize(4 * number.size()));
+      return;
+    }
+    std::vector<unsigned char> bytes(encoded_size());
+    unsigned char *limbs = bytes.data() + biginteger_detail::varint_size(record_header());
+    out.write((const char *) limbs, encode(bytes.data()) - limbs);
+  }
+
+  // Reads one record from the stream straight into this number's limbs. Returns false when the
+  // stream ends before the record starts; a record cut short throws std::invalid_argument.
+  bool read_binary(std::istream &in) {
+    uint64_t header = 0;
+    for (int shift = 0;; shift += 7) {
+      int byte = in.get();
+      if (byte == std::char_traits<char>::eof()) {
+        if (shift == 0) return false;
+        throw std::invalid_argument("truncated BigInteger record");
+      }
+      if (shift > 63) throw std::invalid_argument("malformed BigInteger record");
+      header |= uint64_t(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) break;
+    }
+    uint64_t count = header >> 1;
+    if (count == 0) throw std::invalid_argument("malformed BigInteger record");
+    // The count is not trusted with one big allocation: the limbs grow as the data arrives.
+    const uint64_t step = 1 << 20;
+    number.clear();
+    for (uint64_t done = 0; done < count; done += step) {
+      size_t part = size_t(std::min(step, count - done));
+      number.resize(size_t(done) + part);
+      char *target = (char *) (number.data() + done);
+      if (!in.read(target, std::streamsize(4 * part))) throw std::invalid_argument("truncated BigInteger record");
+    }
+    if (!biginteger_detail::little_endian) {
+      std::vector<int> limbs;
+      limbs.swap(number);
+      load_limbs((const unsigned char *) limbs.data(), count, (header & 1) != 0);
+    } else {
+      sign = (header & 1) == 0;
+      check_limbs();
+    }
+    return true;
+  }
+
+  friend BigInteger gcd(const BigInteger &a, const BigInteger &b);
+  friend BigInteger pow(const BigInteger &x, unsigned long long exponent);
+  friend void mul_into(BigInteger &dst, const BigInteger &a, const BigInteger &b);
+  friend void addmul(BigInteger &dst, const BigInteger &a, const BigInteger &b);
+  friend void submul(BigInteger &dst, const BigInteger &a, const BigInteger &b);
+  friend void divmod(const BigInteger &a, const BigInteger &b, BigInteger &quotient, BigInteger &remainder);
+  template<typename Iterator>
+  friend BigInteger product(Iterator first, Iterator last);
+  friend BigInteger factorial(unsigned n);
+  friend BigInteger binomial(unsigned long long n, unsigned long long k);
+  friend class MontgomeryContext;
+  friend class Rational;
+  template<size_t Bits>
+  friend class FixedBigInt;
+
+ private:
+  static constexpr int base = 1000000000;
+  static constexpr size_t reciprocal_basecase_limbs = 80;
+  static constexpr size_t newton_division_limbs = 160;
+  static constexpr int shift_step_bits = 29;
+  // From these shifts on, one multiplication (division) by 2^k beats 29-bit steps: 2^k reaches
+  // the Karatsuba threshold, respectively the Newton division pays for its reciprocal.
+  static constexpr size_t shift_multiply_bits = 1200;
+  static constexpr size_t shift_divide_bits = 1 << 17;
+  static constexpr size_t binary_basecase_words = 32;
+  // Subtrees of a product with fewer leaves are not worth a thread of their own; their
+  // multiplications still go parallel once they reach parallel_limbs.
+  static constexpr size_t parallel_product_leaves = 256;
+  static inline unsigned parallel_threads = 1;
+  static inline size_t parallel_limbs = 2000;
+  std::vector<int> number;
+  bool sign = true;
+ private:
+  // 2^k, kept per thread: shifts by one count and values next to one power of two tend to come
+  // repeatedly. The reference is valid until the next call on the thread.
+  static const BigInteger &power_of_two(size_t k) {
+    thread_local size_t cached_k = 0;
+    thread_local BigInteger cached = 1;
+    if (cached_k != k) {
+      cached = pow(BigInteger(2), k);
+      cached_k = k;
+    }
+    return cached;
+  }
+
+  uint64_t record_header() const {
+    return (uint64_t(number.size()) << 1) | (sign ? 0 : 1);
+  }
+
+  void load_limbs(const unsigned char *bytes, uint64_t count, bool negative) {
+    if (count == 0) throw std::invalid_argument("malformed BigInteger record");
+    number.resize(size_t(count));
+    if (biginteger_detail::little_endian) {
+      std::memcpy(number.data(), bytes, 4 * size_t(count));
+    } else {
+      for (int &limb : number) {
+        limb = int(uint32_t(bytes[0]) | uint32_t(bytes[1]) << 8 | uint32_t(bytes[2]) << 16 | uint32_t(bytes[3]) << 24);
+        bytes += 4;
+      }
+    }
+    sign = !negative;
+    check_limbs();
+  }
+
+  // Accepts only the canonical form: limbs below the base, no leading zero limb, no -0.
+  void check_limbs() const {
+    for (int limb : number) {
+      if (limb < 0 || limb >= base) throw std::invalid_argument("malformed BigInteger record");
+    }
+    if ((number.size() > 1 && number.back() == 0) || (!sign && number.size() == 1 && number[0] == 0)) {
+      throw std::invalid_argument("malformed BigInteger record");
+    }
+  }
+
+  int compare(int x) const {
+    if (number.empty()) return (x < 0) - (x > 0);
+    long long value = x;
+    if (sign != (value >= 0)) return sign ? 1 : -1;
+    int abs_compare = 1;
+    if (number.size() <= 2) {
+      long long abs_this = (number.size() == 2 ? 1ll * number[1] * base : 0) + number[0];
+      long long abs_x = value < 0 ? -value : value;
+      abs_compare = (abs_this > abs_x) - (abs_this < abs_x);
+    }
+    return sign ? abs_compare : -abs_compare;
+  }
+
+  // Also true for a moved-from value, which has no limbs.
+  bool is_zero() const {
+    return number.empty() || (number.size() == 1 && number[0] == 0);
+  }
+
+  // Compares with q * x for a positive q, forming the product in scratch limbs. |x| may reach
+  // 2^31, so it is taken as two limbs.
+  int compare_product(const BigInteger &q, int x) const {
+    long long value = x;
+    if (sign != (value >= 0)) return sign ? 1 : -1;
+    long long abs_x = value < 0 ? -value : value;
+    size_t n = q.number.size();
+    biginteger_detail::ScratchScope scratch;
+    int *product = scratch.limbs(n + 2);
+    product[n] = biginteger_detail::mul_1(product, q.number.data(), n, int(abs_x % base));
+    product[n + 1] = biginteger_detail::addmul_1(product + 1, q.number.data(), n, int(abs_x / base));
+    size_t length = n + 2;
+    while (length > 1 && product[length - 1] == 0) --length;
+    int abs_compare = 0;
+    if (number.size() != length) {
+      abs_compare = number.size() < length ? -1 : 1;
+    } else {
+      for (size_t i = length; i > 0 && abs_compare == 0; --i) {
+        if (number[i - 1] != product[i - 1]) abs_compare = number[i - 1] < product[i - 1] ? -1 : 1;
+      }
+    }
+    return sign ? abs_compare : -abs_compare;
+  }
+
+  // Compares with q * x for a positive q: by signs, then by limb counts (the product has
+  // q.size + x.size or one limb less), and only then multiplies, into a scratch vector.
+  int compare_product(const BigInteger &q, const BigInteger &x) const {
+    if (sign != x.sign) return sign ? 1 : -1;
+    int abs_compare;
+    size_t limbs = q.number.size() + x.number.size();
+    if (!x) {
+      abs_compare = is_zero() ? 0 : 1;
+    } else if (number.size() + 1 < limbs) {
+      abs_compare = -1;
+    } else if (number.size() > limbs) {
+      abs_compare = 1;
+    } else {
+      biginteger_detail::ScratchScope scratch;
+      std::vector<int> &product = scratch.vector();
+      multiply(product, q.number, x.number);
+      trim(product);
+      abs_compare = compare_abs(number, product);
+    }
+    return sign ? abs_compare : -abs_compare;
+  }
+
+  // The value with only its lowest `limbs` limbs (limbs < size), sign kept unless it becomes 0.
+  // It is congruent to the value modulo 10^(9 limbs), hence modulo 2^(9 limbs).
+  BigInteger low_limbs(size_t limbs) const {
+    BigInteger low;
+    low.number.assign(number.begin(), number.begin() + limbs);
+    low.sign = sign;
+    low.fix_this();
+    return low;
+  }
+
+  // Two's complement words of the value; the infinite extension is all ones when negative.
+  static void twos_complement(const BigInteger &x, std::vector<uint64_t> &words) {
+    biginteger_detail::to_binary(x.number.data(), x.number.size(), words);
+    if (x.sign) return;
+    for (size_t i = 0; words[i]-- == 0; ++i) {}
+    for (uint64_t &word : words) word = ~word;
+  }
+
+  // Decimal limbs of binary words: the high half is scaled by a power of 2^64 and added to the
+  // low half, with the powers 2^(64 * binary_basecase_words * 2^j) squared up once per call.
+  static void from_words(const uint64_t *words, size_t n, std::vector<int> &limbs) {
+    if (n <= binary_basecase_words) {
+      biginteger_detail::from_binary(words, n, limbs);
+      return;
+    }
+    std::vector<BigInteger> powers(1, pow(BigInteger(2), 64 * binary_basecase_words));
+    for (size_t split = binary_basecase_words; 2 * split < n; split *= 2) {
+      powers.push_back(powers.back() * powers.back());
+    }
+    BigInteger result;
+    from_words(words, n, powers.size() - 1, powers, result);
+    limbs.swap(result.number);
+  }
+
+  static void from_words(const uint64_t *words, size_t n, size_t level,
+                         const std::vector<BigInteger> &powers, BigInteger &result) {
+    size_t split = binary_basecase_words << level;
+    while (level > 0 && split >= n) {
+      --level;
+      split /= 2;
+    }
+    if (split >= n) {
+      biginteger_detail::from_binary(words, n, result.number);
+      return;
+    }
+    BigInteger low;
+    from_words(words, split, level, powers, low);
+    from_words(words + split, n - split, level, powers, result);
+    result *= powers[level];
+    result += low;
+  }
+
+  template<typename Op>
+  void bitwise(const BigInteger &another, Op op) {
+    std::vector<uint64_t> a;
+    std::vector<uint64_t> b;
+    twos_complement(*this, a);
+    twos_complement(another, b);
+    uint64_t extension_a = sign ? 0 : ~uint64_t(0);
+    uint64_t extension_b = another.sign ? 0 : ~uint64_t(0);
+    size_t n = std::max(a.size(), b.size());
+    a.resize(n, extension_a);
+    b.resize(n, extension_b);
+    for (size_t i = 0; i < n; ++i) {
+      a[i] = op(a[i], b[i]);
+    }
+    bool negative = op(extension_a, extension_b) != 0;
+    if (negative) {
+      for (uint64_t &word : a) word = ~word;
+      size_t i = 0;
+      while (i < n && ++a[i] == 0) ++i;
+      if (i == n) a.push_back(1);
+    }
+    from_words(a.data(), a.size(), number);
+    sign = !negative;
+    fix_this();
+  }
+
+  static void divmod(const std::vector<int> &a, const std::vector<int> &b,
+                     std::vector<int> &quotient, std::vector<int> &mod) {
+    if (b.size() >= newton_division_limbs && a.size() >= b.size() + newton_division_limbs / 2) {
+      divmod_newton(a, b, quotient, mod);
+    } else {
+      divmod_basecase(a, b, quotient, mod);
+    }
+  }
+
+  // Knuth's algorithm D on magnitudes: quotient and remainder are written without signs.
+  static void divmod_basecase(const std::vector<int> &a, const std::vector<int> &b,
+                              std::vector<int> &quotient, std::vector<int> &mod) {
+    if (compare_abs(a, b) < 0) {
+      quotient.assign(1, 0);
+      mod = a;
+      return;
+    }
+    size_t n = b.size();
+    size_t m = a.size() - n;
+    if (n == 1) {
+      quotient.resize(a.size());
+      mod.assign(1, biginteger_detail::divrem_1(quotient.data(), a.data(), a.size(), b[0]));
+      trim(quotient);
+      return;
+    }
+    int scale = base / (b.back() + 1);
+    biginteger_detail::ScratchScope scratch;
+    std::vector<int> &u = scratch.vector();
+    std::vector<int> &v = scratch.vector();
+    u.assign(a.begin(), a.end());
+    v.assign(b.begin(), b.end());
+    u.push_back(0);
+    mul_small(u, scale);
+    mul_small(v, scale);
+    quotient.assign(m + 1, 0);
+    for (size_t j = m + 1; j > 0; --j) {
+      size_t k = j - 1;
+      long long top = 1ll * u[k + n] * base + u[k + n - 1];
+      long long qhat = top / v[n - 1];
+      long long rhat = top % v[n - 1];
+      while (qhat >= base || qhat * v[n - 2] > rhat * base + u[k + n - 2]) {
+        --qhat;
+        rhat += v[n - 1];
+        if (rhat >= base) break;
+      }
+      u[k + n] -= biginteger_detail::submul_1(&u[k], v.data(), n, int(qhat));
+      if (u[k + n] < 0) {
+        --qhat;
+        u[k + n] += biginteger_detail::add_n(&u[k], &u[k], v.data(), n);
+      }
+      quotient[k] = int(qhat);
+    }
+    u.resize(n);
+    div_small(u, scale);
+    mod.assign(u.begin(), u.end());
+    trim(quotient);
+    trim(mod);
+  }
+
+  static void mul_small(std::vector<int> &a, int x) {
+    int add = biginteger_detail::mul_1(a.data(), a.data(), a.size(), x);
+    if (add) a.push_back(add);
+  }
+
+  static long long div_small(std::vector<int> &a, int x) {
+    int rest = biginteger_detail::divrem_1(a.data(), a.data(), a.size(), x);
+    trim(a);
+    return rest;
+  }
+
+  // |a| += |b|
+  static void add_abs(std::vector<int> &a, const std::vector<int> &b) {
+    size_t m = b.size();
+    if (a.size() < m) a.resize(m, 0);
+    int carry = biginteger_detail::add_n(a.data(), a.data(), b.data(), m);
+    carry = biginteger_detail::add_1(a.data() + m, a.size() - m, carry);
+    if (carry) a.push_back(carry);
+  }
+
+  // a = ||a| - |b||; returns true when |b| > |a|, i.e. when the sign has to flip.
+  static bool sub_abs(std::vector<int> &a, const std::vector<int> &b) {
+    if (compare_abs(a, b) >= 0) {
+      size_t m = b.size();
+      int borrow = biginteger_detail::sub_n(a.data(), a.data(), b.data(), m);
+      biginteger_detail::sub_1(a.data() + m, a.size() - m, borrow);
+      trim(a);
+      return false;
+    }
+    size_t m = a.size();
+    a.resize(b.size());
+    int borrow = biginteger_detail::sub_n(a.data(), b.data(), a.data(), m);
+    for (size_t i = m; i < b.size(); ++i) {
+      a[i] = b[i];
+    }
+    biginteger_detail::sub_1(a.data() + m, a.size() - m, borrow);
+    trim(a);
+    return true;
+  }
+
+  static int compare_abs(const std::vector<int> &a, const std::vector<int> &b) {
+    if (a.size() != b.size()) return a.size() < b.size() ? -1 : 1;
+    for (size_t i = a.size(); i > 0; --i) {
+      if (a[i - 1] != b[i - 1]) return a[i - 1] < b[i - 1] ? -1 : 1;
+    }
+    return 0;
+  }
+
+  static void trim(std::vector<int> &a) {
+    while (a.size() > 1 && !a.back()) {
+      a.pop_back();
+    }
+  }
+
+  // Grows a reused buffer geometrically even when it currently holds a single limb.
+  static void resize_reusing(std::vector<int> &a, size_t n) {
+    if (n > a.capacity()) a.reserve(std::max(n, 2 * a.capacity()));
+    a.resize(n);
+  }
+
+  static void multiply(std::vector<int> &result, const std::vector<int> &a, const std::vector<int> &b) {
+    if (&a == &b) {
+      square(result, a);
+      return;
+    }
+    resize_reusing(result, a.size() + b.size());
+    biginteger_detail::mul_recursive(result.data(), a.data(), a.size(), b.data(), b.size(),
+                                     parallel_threads, parallel_limbs);
+  }
+
+  static void square(std::vector<int> &result, const std::vector<int> &a) {
+    resize_reusing(result, 2 * a.size());
+    biginteger_detail::mul_recursive(result.data(), a.data(), a.size(), a.data(), a.size(),
+                                     parallel_threads, parallel_limbs);
+  }
+
+  static BigInteger from_word(unsigned long long x) {
+    BigInteger result;
+    result.number.assign(1, int(x % base));
+    for (x /= base; x; x /= base) result.number.push_back(int(x % base));
+    return result;
+  }
+
+  // leaf(lo) * ... * leaf(hi - 1), split in halves so that the factors of each multiplication
+  // have about the same size and the subquadratic multiplication pays off, unlike a running
+  // product that keeps multiplying a growing accumulator by small factors.
+  template<typename Leaf>
+  static BigInteger product_tree(const Leaf &leaf, size_t lo, size_t hi, unsigned threads) {
+    if (hi - lo == 1) return leaf(lo);
+    BigInteger left;
+    BigInteger right;
+    if (hi - lo == 2) {
+      left = leaf(lo);
+      right = leaf(lo + 1);
+    } else if (threads > 1 && hi - lo >= parallel_product_leaves) {
+      size_t middle = lo + (hi - lo) / 2;
+      auto task = std::async(std::launch::async, [&] { return product_tree(leaf, lo, middle, threads / 2); });
+      right = product_tree(leaf, middle, hi, threads - threads / 2);
+      left = task.get();
+    } else {
+      size_t middle = lo + (hi - lo) / 2;
+      left = product_tree(leaf, lo, middle, 1);
+      right = product_tree(leaf, middle, hi, 1);
+    }
+    left *= right;
+    return left;
+  }
+
+  static BigInteger word_product(const std::vector<unsigned long long> &words) {
+    if (words.empty()) return 1;
+    return product_tree([&words](size_t i) { return from_word(words[i]); }, 0, words.size(), parallel_threads);
+  }
+
+  // n! = ((n/2)!)^2 * swing(n), where the swing n! / ((n/2)!)^2 is the product of p^e over the
+  // primes p <= n, e being the number of odd values among floor(n / p^i), i >= 1.
+  static BigInteger swing_factorial(unsigned n, const std::vector<unsigned> &primes) {
+    if (n <= 20) {
+      unsigned long long result = 1;
+      for (unsigned i = 2; i <= n; ++i) result *= i;
+      return from_word(result);
+    }
+    BigInteger half = swing_factorial(n / 2, primes);
+    BigInteger result;
+    square(result.number, half.number);
+    biginteger_detail::FactorWords swing;
+    for (unsigned p : primes) {
+      if (p > n) break;
+      for (unsigned q = n / p; q; q /= p) {
+        if (q & 1) swing.push(p);
+      }
+    }
+    result *= word_product(swing.finish());
+    return result;
+  }
+
+  // dst += a * b, or dst -= a * b when `subtract` is set. While the product does not change the
+  // sign of dst and the shorter factor is below the Karatsuba threshold, the rows are accumulated
+  // straight into dst; otherwise the product goes through a per-thread scratch buffer.
+  static void accumulate_product(BigInteger &dst, const BigInteger &a, const BigInteger &b, bool subtract) {
+    if (!a || !b) return;
+    bool product_sign = (a.sign == b.sign) != subtract;
+    const BigInteger &x = a.number.size() <= b.number.size() ? a : b;
+    const BigInteger &y = &x == &a ? b : a;
+    bool aliased = &dst == &a || &dst == &b;
+    if (!dst && !aliased) {
+      multiply(dst.number, a.number, b.number);
+      dst.sign = product_sign;
+      dst.fix_this();
+      return;
+    }
+    if (dst.sign == product_sign && !aliased && x.number.size() < biginteger_detail::karatsuba_limbs) {
+      size_t nx = x.number.size();
+      size_t ny = y.number.size();
+      size_t n = std::max(dst.number.size(), nx + ny) + 1;
+      dst.number.resize(n, 0);
+      int *r = dst.number.data();
+      for (size_t i = 0; i < nx; ++i) {
+        int carry = biginteger_detail::addmul_1(r + i, y.number.data(), ny, x.number[i]);
+        biginteger_detail::add_limb(r + i + ny, n - i - ny, carry);
+      }
+      dst.fix_this();
+      return;
+    }
+    biginteger_detail::ScratchScope scratch;
+    std::vector<int> &product = scratch.vector();
+    multiply(product, a.number, b.number);
+    trim(product);
+    if (dst.sign == product_sign) {
+      add_abs(dst.number, product);
+    } else if (sub_abs(dst.number, product)) {
+      dst.sign = !dst.sign;
+    }
+    dst.fix_this();
+  }
+
+  static void power_of_base(std::vector<int> &result, size_t k) {
+    result.assign(k + 1, 0);
+    result.back() = 1;
+  }
+
+  // floor(base^(2k) / top), where top is formed by the k leading limbs of b. Newton's step
+  // y = 2x - top * x^2 / base^(2k) starts from the reciprocal of slightly more than the top half,
+  // which leaves y within a few units of the answer; the remainder then fixes it exactly.
+  static void reciprocal(const std::vector<int> &b, size_t k, std::vector<int> &result) {
+    biginteger_detail::ScratchScope scratch;
+    std::vector<int> &top = scratch.vector();
+    std::vector<int> &power = scratch.vector();
+    top.assign(b.end() - k, b.end());
+    power_of_base(power, 2 * k);
+    if (k <= reciprocal_basecase_limbs) {
+      divmod_basecase(power, top, result, scratch.vector());
+      return;
+    }
+    size_t h = (k + 5) / 2;
+    std::vector<int> &x = scratch.vector();
+    reciprocal(b, h, x);
+    x.insert(x.begin(), k - h, 0);
+    std::vector<int> &x_square = scratch.vector();
+    std::vector<int> &correction = scratch.vector();
+    square(x_square, x);
+    multiply(correction, top, x_square);
+    correction.erase(correction.begin(), correction.begin() + std::min(2 * k, correction.size()));
+    if (correction.empty()) correction.push_back(0);
+    trim(correction);
+    result.assign(x.begin(), x.end());
+    add_abs(result, x);
+    sub_abs(result, correction);
+    std::vector<int> &product = scratch.vector();
+    multiply(product, top, result);
+    trim(product);
+    std::vector<int> &one = scratch.vector();
+    one.assign(1, 1);
+    while (compare_abs(product, power) > 0) {
+      sub_abs(result, one);
+      sub_abs(product, top);
+    }
+    std::vector<int> &rest = scratch.vector();
+    rest.assign(power.begin(), power.end());
+    sub_abs(rest, product);
+    while (compare_abs(rest, top) >= 0) {
+      add_abs(result, one);
+      sub_abs(rest, top);
+    }
+  }
+
+  // Division through a Newton reciprocal of the divisor: the dividend is consumed in blocks of
+  // b.size() limbs and every block costs two multiplications.
+  static void divmod_newton(const std::vector<int> &a, const std::vector<int> &b,
+                            std::vector<int> &quotient, std::vector<int> &mod) {
+    size_t n = b.size();
+    biginteger_detail::ScratchScope scratch;
+    std::vector<int> &inverse = scratch.vector();
+    reciprocal(b, n, inverse);
+    size_t blocks = (a.size() + n - 1) / n;
+    quotient.assign(blocks * n, 0);
+    std::vector<int> &rest = scratch.vector();
+    std::vector<int> &current = scratch.vector();
+    std::vector<int> &estimate = scratch.vector();
+    std::vector<int> &product = scratch.vector();
+    std::vector<int> &one = scratch.vector();
+    rest.assign(1, 0);
+    one.assign(1, 1);
+    for (size_t block = blocks; block > 0; --block) {
+      size_t low = (block - 1) * n;
+      size_t high = std::min(a.size(), low + n);
+      current.assign(a.begin() + low, a.begin() + high);
+      if (rest.size() > 1 || rest[0] != 0) {
+        current.resize(high - low, 0);
+        current.insert(current.end(), rest.begin(), rest.end());
+      }
+      trim(current);
+      multiply(estimate, current, inverse);
+      estimate.erase(estimate.begin(), estimate.begin() + std::min(2 * n, estimate.size()));
+      if (estimate.empty()) estimate.push_back(0);
+      trim(estimate);
+      multiply(product, estimate, b);
+      trim(product);
+      rest.assign(current.begin(), current.end());
+      sub_abs(rest, product);
+      while (compare_abs(rest, b) >= 0) {
+        add_abs(estimate, one);
+        sub_abs(rest, b);
+      }
+      std::copy(estimate.begin(), estimate.end(), quotient.begin() + low);
+    }
+    trim(quotient);
+    mod.assign(rest.begin(), rest.end());
+  }
+
+  size_t length_num(long long a) const {
+    size_t length = 1;
+    while (a > 9) {
+      a /= 10;
+      ++length;
+    }
+    return length;
+  }
+
+  void fix_this() {
+    while (!number.back() && number.size() > 1) {
+      number.pop_back();
+    }
+    if (number.size() == 1 && number[0] == 0 && !sign) sign = true;
+  }
+
+  std::string tostring_num(int x) const {
+    std::string result;
+    while (x > 9) {
+      result.push_back(x % 10 + '0');
+      x /= 10;
+    }
+    result.push_back(x + '0');
+    int p1 = 0;
+    int p2 = result.size();
+    while (p1 < p2) {
+      std::swap(result[p1++], result[--p2]);
+    }
+    return result;
+  }
+
+  int front_digit() const {
+    int result = number.back();
+    while (result > 9) {
+      result /= 10;
+    }
+    return result;
+  }
+
+};
+
+std::ostream &operator<<(std::ostream &out, const BigInteger &other) {
+  return out << other.toString();
+}
+
+BigInteger operator+(int x, const BigInteger &other) {
+  return BigInteger(x) + other;
+}
+
+// The int is a template parameter so that only an int matches: a Rational would otherwise get
+// here through operator double and make r + BigInteger(...) ambiguous.
+template<typename Int, typename = std::enable_if_t<std::is_same<Int, int>::value>>
+BigInteger operator+(Int x, BigInteger &&other) {
+  return std::move(other += x);
+}
+
+BigInteger operator+(const BigInteger &x, BigInteger &&other) {
+  return std::move(other += x);
+}
+
+BigInteger operator-(int x, const BigInteger &other) {
+  return BigInteger(x) - other;
+}
+
+template<typename Int, typename = std::enable_if_t<std::is_same<Int, int>::value>>
+BigInteger operator-(Int x, BigInteger &&other) {
+  other -= x;
+  other.flip_sign();
+  return std::move(other);
+}
+
+BigInteger operator-(const BigInteger &x, BigInteger &&other) {
+  other -= x;
+  other.flip_sign();
+  return std::move(other);
+}
+
+BigInteger operator*(int x, const BigInteger &other) {
+  return BigInteger(x) * other;
+}
+
+template<typename Int, typename = std::enable_if_t<std::is_same<Int, int>::value>>
+BigInteger operator*(Int x, BigInteger &&other) {
+  return std::move(other *= x);
+}
+
+BigInteger operator*(const BigInteger &x, BigInteger &&other) {
+  return std::move(other *= x);
+}
+
+BigInteger operator/(int x, const BigInteger &other) {
+  return BigInteger(x) / other;
+}
+
+BigInteger operator%(int x, const BigInteger &other) {
+  return BigInteger(x) % other;
+}
+
+namespace biginteger_detail {
+
+inline unsigned long long binary_gcd(unsigned long long a, unsigned long long b) {
+  if (a == 0) return b;
+  if (b == 0) return a;
+  int shift = __builtin_ctzll(a | b);
+  a >>= __builtin_ctzll(a);
+  while (b != 0) {
+    b >>= __builtin_ctzll(b);
+    if (a > b) std::swap(a, b);
+    b -= a;
+  }
+  return a << shift;
+}
+
+}  // namespace biginteger_detail
+
+// Lehmer's algorithm: the quotient sequence is simulated on the two leading limbs and applied
+// to the full numbers at once; operands that fit into 64 bits finish with the binary gcd.
+BigInteger gcd(const BigInteger &x, const BigInteger &y) {
+  using Limbs = std::vector<int>;
+  const long long base = BigInteger::base;
+  biginteger_detail::ScratchScope scratch;
+  Limbs &a = scratch.vector();
+  Limbs &b = scratch.vector();
+  a.assign(x.number.begin(), x.number.end());
+  b.assign(y.number.begin(), y.number.end());
+  if (BigInteger::compare_abs(a, b) < 0) a.swap(b);
+  Limbs &quotient = scratch.vector();
+  Limbs &mod = scratch.vector();
+  Limbs &next_a = scratch.vector();
+  Limbs &next_b = scratch.vector();
+  while (b.size() > 2) {
+    size_t n = a.size();
+    long long A = 1, B = 0, C = 0, D = 1;
+    if (n == b.size() + 1 || n == b.size()) {
+      long long u = 1ll * a[n - 1] * base + a[n - 2];
+      long long v = (n == b.size() ? 1ll * b[n - 1] * base : 0) + b[n - 2];
+      while (v + C != 0 && v + D != 0) {
+        long long q = (u + A) / (v + C);
+        if (q != (u + B) / (v + D)) break;
+        long long new_C = A - q * C;
+        long long new_D = B - q * D;
+        if (new_C >= base || new_C <= -base || new_D >= base || new_D <= -base) break;
+        A = C;
+        B = D;
+        C = new_C;
+        D = new_D;
+        long long t = u - q * v;
+        u = v;
+        v = t;
+      }
+    }
+    if (B == 0) {
+      BigInteger::divmod(a, b, quotient, mod);
+      a.swap(b);
+      b.swap(mod);
+      continue;
+    }
+    next_a.assign(n, 0);
+    next_b.assign(n, 0);
+    long long carry_a = 0;
+    long long carry_b = 0;
+    for (size_t i = 0; i < n; ++i) {
+      long long ai = a[i];
+      long long bi = i < b.size() ? b[i] : 0;
+      long long curr_a = A * ai + B * bi + carry_a;
+      long long curr_b = C * ai + D * bi + carry_b;
+      carry_a = curr_a / base;
+      curr_a %= base;
+      if (curr_a < 0) {
+        curr_a += base;
+        --carry_a;
+      }
+      carry_b = curr_b / base;
+      curr_b %= base;
+      if (curr_b < 0) {
+        curr_b += base;
+        --carry_b;
+      }
+      next_a[i] = curr_a;
+      next_b[i] = curr_b;
+    }
+    BigInteger::trim(next_a);
+    BigInteger::trim(next_b);
+    a.swap(next_a);
+    b.swap(next_b);
+  }
+  if (b.size() == 1 && b[0] == 0) {
+    BigInteger result;
+    result.number.assign(a.begin(), a.end());
+    return result;
+  }
+  if (a.size() > 2) {
+    BigInteger::divmod(a, b, quotient, mod);
+    a.swap(b);
+    b.swap(mod);
+  }
+  auto to_u64 = [base](const Limbs &limbs) {
+    unsigned long long result = limbs.back();
+    if (limbs.size() == 2) result = result * base + limbs[0];
+    return result;
+  };
+  unsigned long long g = biginteger_detail::binary_gcd(to_u64(a), to_u64(b));
+  BigInteger result;
+  result.number.assign(1, g % base);
+  if (g >= (unsigned long long) base) result.number.push_back(g / base);
+  return result;
+}
+
+BigInteger pow(const BigInteger &x, unsigned long long exponent) {
+  BigInteger result = 1;
+  if (exponent == 0) return result;
+  int top = 63;
+  while (!((exponent >> top) & 1)) --top;
+  result = x;
+  biginteger_detail::ScratchScope scratch;
+  std::vector<int> &buffer = scratch.vector();
+  for (int i = top - 1; i >= 0; --i) {
+    BigInteger::square(buffer, result.number);
+    result.number.swap(buffer);
+    result.fix_this();
+    if ((exponent >> i) & 1) {
+      result *= x;
+    }
+  }
+  result.sign = x.sign || exponent % 2 == 0;
+  result.fix_this();
+  return result;
+}
+
+namespace biginteger_detail {
+
+// An upper bound for the k-th root of a positive n, taken from the floating-point estimate.
+inline BigInteger root_upper_bound(const BigInteger &n, unsigned k) {
+  double root_log = n.log10() / k;
+  double int_part = std::floor(root_log);
+  if (int_part < 9) {
+    return BigInteger(int(std::pow(10.0, root_log)) + 2);
+  }
+  BigInteger mantissa = int(std::pow(10.0, root_log - int_part + 6)) + 1;
+  return mantissa.addition_pow(size_t(int_part) - 6);
+}
+
+}  // namespace biginteger_detail
+
+BigInteger isqrt(const BigInteger &n) {
+  if (n < 0) {
+    throw std::domain_error("square root of a negative number");
+  }
+  if (!n) return n;
+  BigInteger x = biginteger_detail::root_upper_bound(n, 2);
+  while (true) {
+    BigInteger y = (n / x + x) / 2;
+    if (y >= x) return x;
+    x = std::move(y);
+  }
+}
+
+BigInteger iroot(const BigInteger &n, unsigned k) {
+  if (k == 0) {
+    throw std::domain_error("zeroth root");
+  }
+  if (n < 0) {
+    if (k % 2 == 0) {
+      throw std::domain_error("even root of a negative number");
+    }
+    return -iroot(-n, k);
+  }
+  if (!n || k == 1) return n;
+  if (k == 2) return isqrt(n);
+  // n < 2^k, so the root is 1.
+  if (k >= n.bit_length()) return 1;
+  // k need not fit an int.
+  BigInteger degree = int(k % biginteger_detail::limb_base);
+  if (k >= unsigned(biginteger_detail::limb_base)) {
+    degree += BigInteger(int(k / biginteger_detail::limb_base)).addition_pow(9);
+  }
+  BigInteger x = biginteger_detail::root_upper_bound(n, k);
+  while (true) {
+    BigInteger y = (n / pow(x, k - 1) + x * (degree - 1)) / degree;
+    if (y >= x) return x;
+    x = std::move(y);
+  }
+}
+
+// dst = a * b, reusing the storage of dst; dst may be one of the operands.
+void mul_into(BigInteger &dst, const BigInteger &a, const BigInteger &b) {
+  bool product_sign = a.sign == b.sign;
+  if (&dst == &a || &dst == &b) {
+    biginteger_detail::ScratchScope scratch;
+    std::vector<int> &buffer = scratch.vector();
+    BigInteger::multiply(buffer, a.number, b.number);
+    dst.number.swap(buffer);
+  } else {
+    BigInteger::multiply(dst.number, a.number, b.number);
+  }
+  dst.sign = product_sign;
+  dst.fix_this();
+}
+
+// dst += a * b without materializing the product as a BigInteger.
+void addmul(BigInteger &dst, const BigInteger &a, const BigInteger &b) {
+  BigInteger::accumulate_product(dst, a, b, false);
+}
+
+// dst -= a * b without materializing the product as a BigInteger.
+void submul(BigInteger &dst, const BigInteger &a, const BigInteger &b) {
+  BigInteger::accumulate_product(dst, a, b, true);
+}
+
+// quotient = a / b rounded toward zero and remainder = a - quotient * b, from one division; the
+// outputs may alias the inputs.
+void divmod(const BigInteger &a, const BigInteger &b, BigInteger &quotient, BigInteger &remainder) {
+  biginteger_detail::ScratchScope scratch;
+  std::vector<int> &q = scratch.vector();
+  std::vector<int> &r = scratch.vector();
+  BigInteger::divmod(a.number, b.number, q, r);
+  bool quotient_sign = a.sign == b.sign;
+  bool remainder_sign = a.sign;
+  quotient.number.assign(q.begin(), q.end());
+  quotient.sign = quotient_sign;
+  quotient.fix_this();
+  remainder.number.assign(r.begin(), r.end());
+  remainder.sign = remainder_sign;
+  remainder.fix_this();
+}
+
+// The product of the values in [first, last), BigInteger or int, through random-access iterators;
+// 1 for an empty range. The factors are multiplied as a balanced tree.
+template<typename Iterator>
+BigInteger product(Iterator first, Iterator last) {
+  size_t n = last - first;
+  if (n == 0) return 1;
+  return BigInteger::product_tree([first](size_t i) { return BigInteger(first[i]); }, 0, n,
+                                  BigInteger::parallel_threads);
+}
+
+// n!, by the prime swing factorization.
+BigInteger factorial(unsigned n) {
+  return BigInteger::swing_factorial(n, biginteger_detail::primes_up_to(n));
+}
+
+// The binomial coefficient C(n, k), 0 when k > n. When k is a sizeable fraction of n, the
+// coefficient is assembled from its prime factorization (Legendre's formula) and no division
+// is needed; otherwise n (n - 1) ... (n - k + 1) is divided by k!.
+BigInteger binomial(unsigned long long n, unsigned long long k) {
+  if (k > n) return 0;
+  k = std::min(k, n - k);
+  if (k == 0) return 1;
+  if (k > std::numeric_limits<unsigned>::max()) {
+    throw std::domain_error("binomial coefficient too large");
+  }
+  biginteger_detail::FactorWords factors;
+  if (n <= std::numeric_limits<unsigned>::max() && k >= n / 32) {
+    for (unsigned p : biginteger_detail::primes_up_to(unsigned(n))) {
+      for (unsigned long long a = n / p, b = k / p, c = (n - k) / p; a; a /= p, b /= p, c /= p) {
+        for (unsigned long long e = a - b - c; e; --e) factors.push(p);
+      }
+    }
+    return BigInteger::word_product(factors.finish());
+  }
+  for (unsigned long long i = 0; i < k; ++i) factors.push(n - i);
+  return BigInteger::word_product(factors.finish()) / factorial(unsigned(k));
+}
+
+// Expression templates for sums of products. lazy(a) * b + lazy(c) * d - e builds a tree of
+// references instead of temporaries, and evaluate(dst, expression) folds it term by term with
+// addmul/submul into an accumulator that trades buffers with dst, so a loop such as Horner's
+// rule (evaluate(acc, lazy(acc) * x + c)) stops allocating once the buffers have grown.
+// The tree holds references: it must be evaluated within the full expression that builds it.
+namespace biginteger_detail {
+
+struct TermExpr {
+  const BigInteger &value;
+
+  void accumulate(BigInteger &acc, bool subtract) const {
+    if (subtract) {
+      acc -= value;
+    } else {
+      acc += value;
+    }
+  }
+};
+
+struct ProductExpr {
+  const BigInteger &left;
+  const BigInteger &right;
+
+  void accumulate(BigInteger &acc, bool subtract) const {
+    if (subtract) {
+      submul(acc, left, right);
+    } else {
+      addmul(acc, left, right);
+    }
+  }
+};
+
+template<typename Left, typename Right, bool Subtract>
+struct SumExpr {
+  Left left;
+  Right right;
+
+  void accumulate(BigInteger &acc, bool subtract) const {
+    left.accumulate(acc, subtract);
+    right.accumulate(acc, subtract != Subtract);
+  }
+};
+
+template<typename T>
+struct is_expression : std::false_type {};
+
+template<>
+struct is_expression<TermExpr> : std::true_type {};
+
+template<>
+struct is_expression<ProductExpr> : std::true_type {};
+
+template<typename Left, typename Right, bool Subtract>
+struct is_expression<SumExpr<Left, Right, Subtract>> : std::true_type {};
+
+template<typename T>
+using expression_t = std::enable_if_t<is_expression<T>::value, T>;
+
+template<typename T>
+expression_t<T> as_expression(const T &expression) {
+  return expression;
+}
+
+// Only BigInteger lvalues become leaves: a converted temporary would not outlive the operator.
+template<typename T>
+std::enable_if_t<std::is_same<T, BigInteger>::value, TermExpr> as_expression(const T &value) {
+  return TermExpr{value};
+}
+
+// Accepts any two operands of which at least one is an expression node.
+template<typename Left, typename Right>
+using sum_operands_t = std::enable_if_t<is_expression<Left>::value || is_expression<Right>::value,
+                                        decltype(as_expression(std::declval<Right>()))>;
+
+}  // namespace biginteger_detail
+
+inline biginteger_detail::TermExpr lazy(const BigInteger &value) {
+  return biginteger_detail::TermExpr{value};
+}
+
+inline biginteger_detail::ProductExpr operator*(biginteger_detail::TermExpr left,
+                                                biginteger_detail::TermExpr right) {
+  return biginteger_detail::ProductExpr{left.value, right.value};
+}
+
+inline biginteger_detail::ProductExpr operator*(biginteger_detail::TermExpr left, const BigInteger &right) {
+  return biginteger_detail::ProductExpr{left.value, right};
+}
+
+template<typename Left, typename Right,
+    typename RightExpr = biginteger_detail::sum_operands_t<Left, Right>>
+auto operator+(const Left &left, const Right &right)
+    -> biginteger_detail::SumExpr<decltype(biginteger_detail::as_expression(left)), RightExpr, false> {
+  return {biginteger_detail::as_expression(left), biginteger_detail::as_expression(right)};
+}
+
+template<typename Left, typename Right,
+    typename RightExpr = biginteger_detail::sum_operands_t<Left, Right>>
+auto operator-(const Left &left, const Right &right)
+    -> biginteger_detail::SumExpr<decltype(biginteger_detail::as_expression(left)), RightExpr, true> {
+  return {biginteger_detail::as_expression(left), biginteger_detail::as_expression(right)};
+}
+
+// dst = expression; dst may appear inside the expression.
+template<typename Expression, typename = biginteger_detail::expression_t<Expression>>
+void evaluate(BigInteger &dst, const Expression &expression) {
+  thread_local BigInteger acc;
+  acc = 0;
+  expression.accumulate(acc, false);
+  dst.swap(acc);
+}
+
+// Modular arithmetic for a fixed modulus. Moduli coprime to 10 (the limb base is 10^9) are kept
+// in Montgomery form with R = 10^(9 * limbs); all intermediate limbs live in buffers allocated
+// once by the constructor. Other moduli fall back to plain multiplication and division.
+class MontgomeryContext {
+ public:
+  explicit MontgomeryContext(const BigInteger &modulus, bool constant_time = false)
+      : mod(modulus), constant_time(constant_time) {
+    if (mod.signum() <= 0) {
+      throw std::invalid_argument("modulus must be positive");
+    }
+    n = mod.number.size();
+    int low = mod.number.front();
+    montgomery = (low % 2 != 0) && (low % 5 != 0);
+    if (!montgomery) return;
+    inv = (base - inverse_limb(low)) % base;
+    BigInteger R2 = BigInteger(1).addition_pow(18 * n) % mod;
+    r2 = padded(R2);
+    BigInteger R1 = BigInteger(1).addition_pow(9 * n) % mod;
+    one = padded(R1);
+    t.assign(2 * n + 2, 0);
+    x.assign(n, 0);
+    y.assign(n, 0);
+  }
+
+  const BigInteger &modulus() const {
+    return mod;
+  }
+
+  BigInteger mulmod(const BigInteger &a, const BigInteger &b) {
+    if (!montgomery) return reduce(a * b);
+    load(x, a);
+    load(y, b);
+    mont_mul(x.data(), r2.data(), x.data());
+    mont_mul(x.data(), y.data(), x.data());
+    return unload(x);
+  }
+
+  // Left-to-right sliding window exponentiation. In constant-time mode a fixed window is used and
+  // every table entry is touched on each lookup; Montgomery multiplication itself has no
+  // data-dependent branch in either mode. The time still depends on the lengths of the operands
+  // and the exponent, and a negative exponent or base goes through invmod or a division, which
+  // are not constant-time.
+  BigInteger powmod(const BigInteger &a, const BigInteger &exponent) {
+    if (exponent.signum() < 0) {
+      return powmod(invmod(a), -exponent);
+    }
+    std::vector<int> bits = exponent_bits(exponent);
+    if (!montgomery) {
+      BigInteger result = reduce(1);
+      BigInteger power = reduce(a);
+      for (size_t i = bits.size(); i > 0; --i) {
+        result = reduce(result * result);
+        if (bits[i - 1]) result = reduce(result * power);
+      }
+      return result;
+    }
+    size_t window = constant_time ? 4 : window_size(bits.size());
+    size_t table_size = constant_time ? (size_t(1) << window) : (size_t(1) << (window - 1));
+    table.resize(table_size * n);
+    load(y, a);
+    mont_mul(y.data(), r2.data(), y.data());
+    if (constant_time) {
+      std::copy(one.begin(), one.end(), table.begin());
+      for (size_t i = 1; i < table_size; ++i) {
+        mont_mul(&table[(i - 1) * n], y.data(), &table[i * n]);
+      }
+      std::copy(one.begin(), one.end(), x.begin());
+      size_t top = (bits.size() + window - 1) / window * window;
+      for (size_t i = top; i > 0; i -= window) {
+        size_t digit = 0;
+        for (size_t j = 0; j < window; ++j) {
+          mont_mul(x.data(), x.data(), x.data());
+          size_t bit = i - 1 - j;
+          digit = digit * 2 + (bit < bits.size() ? bits[bit] : 0);
+        }
+        select(digit, table_size);
+        mont_mul(x.data(), y.data(), x.data());
+      }
+    } else {
+      std::copy(y.begin(), y.end(), table.begin());
+      mont_mul(y.data(), y.data(), y.data());
+      for (size_t i = 1; i < table_size; ++i) {
+        mont_mul(&table[(i - 1) * n], y.data(), &table[i * n]);
+      }
+      std::copy(one.begin(), one.end(), x.begin());
+      size_t i = bits.size();
+      while (i > 0) {
+        if (!bits[i - 1]) {
+          mont_mul(x.data(), x.data(), x.data());
+          --i;
+          continue;
+        }
+        size_t low = i > window ? i - window : 0;
+        while (!bits[low]) ++low;
+        size_t digit = 0;
+        for (size_t j = i; j > low; --j) {
+          mont_mul(x.data(), x.data(), x.data());
+          digit = digit * 2 + bits[j - 1];
+        }
+        mont_mul(x.data(), &table[(digit / 2) * n], x.data());
+        i = low;
+      }
+    }
+    mont_mul(x.data(), unit().data(), x.data());
+    return unload(x);
+  }
+
+  BigInteger invmod(const BigInteger &a) {
+    BigInteger r0 = mod;
+    BigInteger r1 = reduce(a);
+    BigInteger s0 = 0;
+    BigInteger s1 = 1;
+    while (r1.signum() != 0) {
+      BigInteger q = r0 / r1;
+      r0 -= q * r1;
+      std::swap(r0, r1);
+      s0 -= q * s1;
+      std::swap(s0, s1);
+    }
+    if (r0 != 1) {
+      throw std::domain_error("value is not invertible modulo the modulus");
+    }
+    return reduce(s0);
+  }
+
+ private:
+  static constexpr int base = BigInteger::base;
+
+  BigInteger mod;
+  bool constant_time;
+  bool montgomery = false;
+  size_t n = 0;
+  long long inv = 0;
+  std::vector<int> r2;
+  std::vector<int> one;
+  std::vector<int> t;
+  std::vector<int> x;
+  std::vector<int> y;
+  std::vector<int> table;
+  std::vector<int> unit_limbs;
+
+  static long long inverse_limb(long long a) {
+    long long r0 = base, r1 = a, s0 = 0, s1 = 1;
+    while (r1 != 0) {
+      long long q = r0 / r1;
+      r0 -= q * r1;
+      std::swap(r0, r1);
+      s0 -= q * s1;
+      std::swap(s0, s1);
+    }
+    return (s0 % base + base) % base;
+  }
+
+  static size_t window_size(size_t bits) {
+    if (bits <= 24) return 1;
+    if (bits <= 80) return 3;
+    if (bits <= 240) return 4;
+    if (bits <= 672) return 5;
+    return 6;
+  }
+
+  static std::vector<int> exponent_bits(const BigInteger &exponent) {
+    std::vector<int> bits;
+    std::vector<int> rest = exponent.number;
+    while (rest.size() > 1 || rest[0] != 0) {
+      int chunk = BigInteger::div_small(rest, 1 << 29);
+      bool last = rest.size() == 1 && rest[0] == 0;
+      for (int i = 0; i < 29 && (!last || chunk != 0); ++i) {
+        bits.push_back(chunk & 1);
+        chunk >>= 1;
+      }
+    }
+    return bits;
+  }
+
+  BigInteger reduce(const BigInteger &a) const {
+    BigInteger result = a % mod;
+    if (result.signum() < 0) result += mod;
+    return result;
+  }
+
+  std::vector<int> padded(const BigInteger &a) const {
+    std::vector<int> result = a.number;
+    result.resize(n, 0);
+    return result;
+  }
+
+  // Anything in [0, R) is taken as it is, since mont_mul reduces a product with one factor below
+  // R; the value is never compared with the modulus.
+  void load(std::vector<int> &target, const BigInteger &a) const {
+    if (a.signum() >= 0 && a.number.size() <= n) {
+      std::copy(a.number.begin(), a.number.end(), target.begin());
+      std::fill(target.begin() + a.number.size(), target.end(), 0);
+    } else {
+      BigInteger reduced = reduce(a);
+      std::copy(reduced.number.begin(), reduced.number.end(), target.begin());
+      std::fill(target.begin() + reduced.number.size(), target.end(), 0);
+    }
+  }
+
+  BigInteger unload(const std::vector<int> &limbs) const {
+    BigInteger result;
+    result.number.assign(limbs.begin(), limbs.end());
+    result.fix_this();
+    return result;
+  }
+
+  const std::vector<int> &unit() {
+    if (unit_limbs.empty()) {
+      unit_limbs.assign(n, 0);
+      unit_limbs[0] = 1;
+    }
+    return unit_limbs;
+  }
+
+  void select(size_t digit, size_t table_size) {
+    std::fill(y.begin(), y.end(), 0);
+    for (size_t i = 0; i < table_size; ++i) {
+      int mask = -int(i == digit);
+      for (size_t j = 0; j < n; ++j) {
+        y[j] |= table[i * n + j] & mask;
+      }
+    }
+  }
+
+  // Montgomery multiplication by separated operand scanning: out = a * b / R mod N for
+  // a * b < N * R; out may alias a or b. Row i of the reduction clears t[i], which then holds the row's
+  // carry until a single add_n moves all of them up, so no carry loop depends on the data.
+  void mont_mul(const int *a, const int *b, int *out) {
+    std::fill(t.begin(), t.end(), 0);
+    for (size_t i = 0; i < n; ++i) {
+      t[i + n] = biginteger_detail::addmul_1(&t[i], b, n, a[i]);
+    }
+    for (size_t i = 0; i < n; ++i) {
+      int m = int(1ll * t[i] * inv % base);
+      t[i] = biginteger_detail::addmul_1(&t[i], mod.number.data(), n, m);
+    }
+    int *high = &t[n];
+    high[n] = biginteger_detail::add_n(high, high, t.data(), n);
+    int borrow = biginteger_detail::sub_n(out, high, mod.number.data(), n);
+    // t >= N exactly when the subtraction did not borrow past the top limb.
+    int keep = -int(high[n] - borrow < 0);
+    for (size_t j = 0; j < n; ++j) {
+      out[j] = (high[j] & keep) | (out[j] & ~keep);
+    }
+  }
+};
+
+// A signed integer of exactly Bits bits (a multiple of 64) in two's complement, with the limbs
+// in a plain array on the stack: arithmetic wraps modulo 2^Bits like the built-in integers and
+// every loop runs over a compile-time number of 64-bit limbs, so the compiler can unroll it.
+// All arithmetic and comparisons are constexpr; / and % truncate toward zero, as BigInteger does.
+template<size_t Bits>
+class FixedBigInt {
+  static_assert(Bits > 0 && Bits % 64 == 0, "FixedBigInt needs a positive multiple of 64 bits");
+
+ public:
+  static constexpr size_t limbs = Bits / 64;
+
+  constexpr FixedBigInt() : words{} {}
+
+  constexpr FixedBigInt(long long x) : words{} {
+    words[0] = uint64_t(x);
+    for (size_t i = 1; i < limbs; ++i) {
+      words[i] = x < 0 ? ~uint64_t(0) : 0;
+    }
+  }
+
+  // Keeps the low Bits bits of the two's complement form of x.
+  explicit FixedBigInt(const BigInteger &x) : words{} {
+    std::vector<uint64_t> source;
+    BigInteger::twos_complement(x, source);
+    uint64_t extension = x.sign ? 0 : ~uint64_t(0);
+    for (size_t i = 0; i < limbs; ++i) {
+      words[i] = i < source.size() ? source[i] : extension;
+    }
+  }
+
+  explicit operator BigInteger() const {
+    FixedBigInt magnitude = negative() ? -*this : *this;
+    BigInteger result;
+    BigInteger::from_words(magnitude.words, limbs, result.number);
+    result.sign = !negative();
+    result.fix_this();
+    return result;
+  }
+
+  std::string toString() const {
+    return BigInteger(*this).toString();
+  }
+
+  constexpr bool negative() const {
+    return (words[limbs - 1] >> 63) != 0;
+  }
+
+  constexpr explicit operator bool() const {
+    for (size_t i = 0; i < limbs; ++i) {
+      if (words[i]) return true;
+    }
+    return false;
+  }
+
+  constexpr FixedBigInt operator-() const {
+    FixedBigInt result;
+    unsigned __int128 carry = 1;
+    for (size_t i = 0; i < limbs; ++i) {
+      carry += ~words[i];
+      result.words[i] = uint64_t(carry);
+      carry >>= 64;
+    }
+    return result;
+  }
+
+  constexpr FixedBigInt &operator+=(const FixedBigInt &another) {
+    unsigned __int128 carry = 0;
+    for (size_t i = 0; i < limbs; ++i) {
+      carry += (unsigned __int128) words[i] + another.words[i];
+      words[i] = uint64_t(carry);
+      carry >>= 64;
+    }
+    return *this;
   }
 
-  BigInteger addition_pow(size_t x) const {
-    if (x == 0) return *this;
-    if (*this == 0) return *this;
-    BigInteger result;
-    result.sign = sign;
-    result.number.resize(x / 9);
-    for (size_t i = 0; i < number.size(); ++i) {
-      result.number.push_back(number[i]);
-    }
-    x %= 9;
-    int mod_pow = 1;
-    for (size_t i = 0; i < x; ++i) {
-      mod_pow *= 10;
+  constexpr FixedBigInt &operator-=(const FixedBigInt &another) {
+    uint64_t borrow = 0;
+    for (size_t i = 0; i < limbs; ++i) {
+      uint64_t diff = words[i] - another.words[i];
+      uint64_t next = (diff > words[i]) | (diff < borrow);
+      words[i] = diff - borrow;
+      borrow = next;
     }
-    result *= mod_pow;
-    return result;
+    return *this;
   }
 
-  void build_string(const std::string &s) {
-    number.clear();
-    sign = s.front() != '-';
-    size_t i = s.size() - 1;
-    while (i + 1 > 0 && s[i] != '-') {
-      number.push_back(0);
-      int pow = 1;
-      for (size_t j = 0; j < 9 && i + 1 > 0 && s[i] != '-'; ++j, --i) {
-        number.back() += pow * (s[i] - '0');
-        pow *= 10;
+  // Only the products that land below 2^Bits are formed.
+  constexpr FixedBigInt &operator*=(const FixedBigInt &another) {
+    FixedBigInt result;
+    for (size_t i = 0; i < limbs; ++i) {
+      unsigned __int128 carry = 0;
+      for (size_t j = 0; i + j < limbs; ++j) {
+        carry += (unsigned __int128) words[i] * another.words[j] + result.words[i + j];
+        result.words[i + j] = uint64_t(carry);
+        carry >>= 64;
       }
     }
+    return *this = result;
   }
 
-  size_t length() const {
-    return (number.size() - 1) * 9 + length_num(number.back());
+  constexpr FixedBigInt &operator/=(const FixedBigInt &another) {
+    FixedBigInt quotient;
+    FixedBigInt remainder;
+    divmod(*this, another, quotient, remainder);
+    return *this = quotient;
   }
 
- private:
-  int base = 1000000000;
-  std::vector<int> number;
-  bool sign = true;
- private:
-  size_t length_num(long long a) const {
-    size_t length = 1;
-    while (a > 9) {
-      a /= 10;
-      ++length;
-    }
-    return length;
+  constexpr FixedBigInt &operator%=(const FixedBigInt &another) {
+    FixedBigInt quotient;
+    FixedBigInt remainder;
+    divmod(*this, another, quotient, remainder);
+    return *this = remainder;
   }
 
-  void fix_this() {
-    while (!number.back() && number.size() > 1) {
-      number.pop_back();
-    }
-    if (number.size() == 1 && number[0] == 0 && !sign) sign = true;
+  friend constexpr FixedBigInt operator+(FixedBigInt a, const FixedBigInt &b) {
+    return a += b;
   }
 
-  std::string tostring_num(int x) const {
-    std::string result;
-    while (x > 9) {
-      result.push_back(x % 10 + '0');
-      x /= 10;
-    }
-    result.push_back(x + '0');
-    int p1 = 0;
-    int p2 = result.size();
-    while (p1 < p2) {
-      std::swap(result[p1++], result[--p2]);
-    }
-    return result;
+  friend constexpr FixedBigInt operator-(FixedBigInt a, const FixedBigInt &b) {
+    return a -= b;
   }
 
-  int front_digit() const {
-    int result = number.back();
-    while (result > 9) {
-      result /= 10;
+  friend constexpr FixedBigInt operator*(FixedBigInt a, const FixedBigInt &b) {
+    return a *= b;
+  }
+
+  friend constexpr FixedBigInt operator/(FixedBigInt a, const FixedBigInt &b) {
+    return a /= b;
+  }
+
+  friend constexpr FixedBigInt operator%(FixedBigInt a, const FixedBigInt &b) {
+    return a %= b;
+  }
+
+  friend constexpr bool operator==(const FixedBigInt &a, const FixedBigInt &b) {
+    for (size_t i = 0; i < limbs; ++i) {
+      if (a.words[i] != b.words[i]) return false;
     }
-    return result;
+    return true;
   }
 
-};
+  friend constexpr bool operator!=(const FixedBigInt &a, const FixedBigInt &b) {
+    return !(a == b);
+  }
 
-std::ostream &operator<<(std::ostream &out, const BigInteger &other) {
-  return out << other.toString();
-}
+  friend constexpr bool operator<(const FixedBigInt &a, const FixedBigInt &b) {
+    if (a.negative() != b.negative()) return a.negative();
+    return compare_abs(a.words, b.words, limbs) < 0;
+  }
 
-BigInteger operator+(int x, const BigInteger &other) {
-  return BigInteger(x) + other;
-}
+  friend constexpr bool operator>(const FixedBigInt &a, const FixedBigInt &b) {
+    return b < a;
+  }
 
-BigInteger operator-(int x, const BigInteger &other) {
-  return BigInteger(x) - other;
-}
+  friend constexpr bool operator<=(const FixedBigInt &a, const FixedBigInt &b) {
+    return !(b < a);
+  }
 
-BigInteger operator*(int x, const BigInteger &other) {
-  return BigInteger(x) * other;
-}
+  friend constexpr bool operator>=(const FixedBigInt &a, const FixedBigInt &b) {
+    return !(a < b);
+  }
 
-BigInteger operator/(int x, const BigInteger &other) {
-  return BigInteger(x) / other;
-}
+  // quotient = a / b rounded toward zero, remainder = a - quotient * b.
+  static constexpr void divmod(const FixedBigInt &a, const FixedBigInt &b,
+                               FixedBigInt &quotient, FixedBigInt &remainder) {
+    if (!b) {
+      throw std::domain_error("division by zero");
+    }
+    FixedBigInt abs_a = a.negative() ? -a : a;
+    FixedBigInt abs_b = b.negative() ? -b : b;
+    divmod_abs(abs_a.words, abs_b.words, quotient.words, remainder.words);
+    if (a.negative() != b.negative()) quotient = -quotient;
+    if (a.negative()) remainder = -remainder;
+  }
 
-BigInteger operator%(int x, const BigInteger &other) {
-  return BigInteger(x) % other;
+ private:
+  uint64_t words[limbs];
+
+  // Compares n limbs as unsigned numbers.
+  static constexpr int compare_abs(const uint64_t *a, const uint64_t *b, size_t n) {
+    for (size_t i = n; i > 0; --i) {
+      if (a[i - 1] != b[i - 1]) return a[i - 1] < b[i - 1] ? -1 : 1;
+    }
+    return 0;
+  }
+
+  static constexpr size_t significant(const uint64_t *a) {
+    size_t n = limbs;
+    while (n > 0 && !a[n - 1]) --n;
+    return n;
+  }
+
+  static constexpr void divmod_abs(const uint64_t *u, const uint64_t *v, uint64_t *q, uint64_t *r) {
+    using u128 = unsigned __int128;
+    for (size_t i = 0; i < limbs; ++i) {
+      q[i] = 0;
+      r[i] = 0;
+    }
+    size_t n = significant(v);
+    size_t m = significant(u);
+    if (m < n || (m == n && compare_abs(u, v, n) < 0)) {
+      for (size_t i = 0; i < limbs; ++i) r[i] = u[i];
+      return;
+    }
+    if (n == 1) {
+      u128 rest = 0;
+      for (size_t i = m; i > 0; --i) {
+        u128 curr = (rest << 64) | u[i - 1];
+        q[i - 1] = uint64_t(curr / v[0]);
+        rest = curr % v[0];
+      }
+      r[0] = uint64_t(rest);
+      return;
+    }
+    if constexpr (limbs > 1) divmod_knuth(u, v, q, r, m, n);
+  }
+
+  // Knuth's algorithm D on unsigned limbs for an n-limb divisor (n >= 2), with 128-bit steps for
+  // the quotient estimates; q and r come in zeroed.
+  static constexpr void divmod_knuth(const uint64_t *u, const uint64_t *v, uint64_t *q, uint64_t *r,
+                                     size_t m, size_t n) {
+    using u128 = unsigned __int128;
+    int s = __builtin_clzll(v[n - 1]);
+    uint64_t vn[limbs] = {};
+    uint64_t un[limbs + 1] = {};
+    for (size_t i = n - 1; i > 0; --i) {
+      vn[i] = (v[i] << s) | (s ? v[i - 1] >> (64 - s) : 0);
+    }
+    vn[0] = v[0] << s;
+    un[m] = s ? u[m - 1] >> (64 - s) : 0;
+    for (size_t i = m - 1; i > 0; --i) {
+      un[i] = (u[i] << s) | (s ? u[i - 1] >> (64 - s) : 0);
+    }
+    un[0] = u[0] << s;
+    const u128 limb = u128(1) << 64;
+    for (size_t j = m - n + 1; j > 0; --j) {
+      size_t k = j - 1;
+      u128 top = (u128(un[k + n]) << 64) | un[k + n - 1];
+      u128 qhat = top / vn[n - 1];
+      u128 rhat = top % vn[n - 1];
+      while (qhat >= limb || qhat * vn[n - 2] > ((rhat << 64) | un[k + n - 2])) {
+        --qhat;
+        rhat += vn[n - 1];
+        if (rhat >= limb) break;
+      }
+      // un[k..k+n] -= qhat * vn, with the borrow kept as a signed 128-bit value.
+      __int128 borrow = 0;
+      __int128 t = 0;
+      for (size_t i = 0; i < n; ++i) {
+        u128 product = qhat * vn[i];
+        t = __int128(un[i + k]) - borrow - __int128(uint64_t(product));
+        un[i + k] = uint64_t(t);
+        borrow = __int128(product >> 64) - (t >> 64);
+      }
+      t = __int128(un[k + n]) - borrow;
+      un[k + n] = uint64_t(t);
+      q[k] = uint64_t(qhat);
+      if (t < 0) {
+        --q[k];
+        u128 carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+          carry += u128(un[i + k]) + vn[i];
+          un[i + k] = uint64_t(carry);
+          carry >>= 64;
+        }
+        un[k + n] += uint64_t(carry);
+      }
+    }
+    for (size_t i = 0; i < n; ++i) {
+      r[i] = (un[i] >> s) | (s ? un[i + 1] << (64 - s) : 0);
+    }
+  }
+};
+
+template<size_t Bits>
+std::ostream &operator<<(std::ostream &out, const FixedBigInt<Bits> &x) {
+  return out << x.toString();
 }
 
 class Rational {
@@ -451,59 +2802,117 @@ class Rational {
 
   Rational(int x) : P(x), Q(1) {}
 
-  Rational(const Rational &another) : P(another.P), Q(another.Q) {}
+  // With lazy normalization enabled the gcd reduction is postponed until the numerator and
+  // denominator together exceed `threshold` decimal digits. Const operations never reduce in
+  // place, so concurrent reads of a shared Rational stay safe: comparisons work on the
+  // unreduced values and toString() reduces a copy.
+  static void set_lazy_normalization(bool enabled, size_t threshold = 1000) {
+    lazy_normalization = enabled;
+    lazy_threshold = threshold;
+  }
+
+  Rational(BigInteger &&x) : P(std::move(x)), Q(1) {}
+
+  Rational(const Rational &another) : P(another.P), Q(another.Q), reduced(another.reduced) {}
+
+  // Allocation-free; the moved-from Rational can only be assigned to or destroyed.
+  Rational(Rational &&another) noexcept
+      : P(std::move(another.P)), Q(std::move(another.Q)), reduced(another.reduced) {
+    another.reduced = true;
+  }
 
-  Rational() = default;
+  Rational() : P(0), Q(1) {}
 
   ~Rational() = default;
 
   Rational &operator=(const Rational &another) {
     P = another.P;
     Q = another.Q;
+    reduced = another.reduced;
+    return *this;
+  }
+
+  Rational &operator=(Rational &&another) noexcept {
+    P = std::move(another.P);
+    Q = std::move(another.Q);
+    reduced = another.reduced;
     return *this;
   }
 
   Rational &operator=(const BigInteger &another) {
     P = another;
     Q = 1;
+    reduced = true;
+    return *this;
+  }
+
+  Rational &operator=(BigInteger &&another) {
+    P = std::move(another);
+    Q = 1;
+    reduced = true;
     return *this;
   }
 
   Rational &operator=(int x) {
     P = BigInteger(x);
     Q = 1;
+    reduced = true;
     return *this;
   }
 
-  Rational operator-() const {
+  Rational operator-() const & {
     Rational result = *this;
     result.P.flip_sign();
     return result;
   }
 
+  Rational operator-() && {
+    P.flip_sign();
+    return std::move(*this);
+  }
+
   Rational &operator+=(const Rational &another) {
-    BigInteger another_P = (another.P * Q);
-    P *= another.Q;
-    Q *= another.Q;
-    P += another_P;
+    if (Q == another.Q) {
+      P += another.P;
+    } else {
+      P *= another.Q;
+      P += another.P * Q;
+      Q *= another.Q;
+    }
     fix();
     return *this;
   }
 
-  Rational operator+(const Rational &another) const {
+  Rational operator+(const Rational &another) const & {
     Rational result = *this;
     return result += another;
   }
 
+  Rational operator+(const Rational &another) && {
+    return std::move(*this += another);
+  }
+
   Rational &operator-=(const Rational &another) {
-    return (*this += (-another));
+    if (Q == another.Q) {
+      P -= another.P;
+    } else {
+      P *= another.Q;
+      P -= another.P * Q;
+      Q *= another.Q;
+    }
+    fix();
+    return *this;
   }
 
-  Rational operator-(const Rational &another) const {
+  Rational operator-(const Rational &another) const & {
     Rational result = *this;
     return result -= another;
   }
 
+  Rational operator-(const Rational &another) && {
+    return std::move(*this -= another);
+  }
+
   Rational &operator*=(const Rational &another) {
     P *= another.P;
     Q *= another.Q;
@@ -511,11 +2920,15 @@ class Rational {
     return *this;
   }
 
-  Rational operator*(const Rational &another) const {
+  Rational operator*(const Rational &another) const & {
     Rational result = *this;
     return result *= another;
   }
 
+  Rational operator*(const Rational &another) && {
+    return std::move(*this *= another);
+  }
+
   Rational &operator/=(const Rational &another) {
     P *= another.Q;
     Q *= another.P;
@@ -527,13 +2940,18 @@ class Rational {
     return *this;
   }
 
-  Rational operator/(const Rational &another) const {
+  Rational operator/(const Rational &another) const & {
     Rational result = *this;
     return result /= another;
   }
 
+  Rational operator/(const Rational &another) && {
+    return std::move(*this /= another);
+  }
+
   bool operator==(const Rational &another) const {
-    return (Q == another.Q) && (P == another.P);
+    if (reduced && another.reduced) return (Q == another.Q) && (P == another.P);
+    return P * another.Q == another.P * Q;
   }
 
   bool operator!=(const Rational &another) const {
@@ -541,7 +2959,7 @@ class Rational {
   }
 
   bool operator<(const Rational &another) const {
-    return (P * another.Q < another.P * Q);
+    return less(P, Q, another.P, another.Q);
   }
 
   bool operator>(const Rational &another) const {
@@ -557,36 +2975,88 @@ class Rational {
   }
 
   Rational &operator+=(const BigInteger &x) {
-    return *this += Rational(x);
+    if (Q == 1) {
+      P += x;
+    } else {
+      P += x * Q;
+    }
+    return *this;
+  }
+
+  Rational operator+(const BigInteger &x) const & {
+    Rational result = *this;
+    return result += x;
   }
 
-  Rational operator+(const BigInteger &x) const {
-    return *this + Rational(x);
+  Rational operator+(const BigInteger &x) && {
+    return std::move(*this += x);
   }
   Rational &operator-=(const BigInteger &x) {
-    return *this -= Rational(x);
+    if (Q == 1) {
+      P -= x;
+    } else {
+      P -= x * Q;
+    }
+    return *this;
   }
 
-  Rational operator-(const BigInteger &x) const {
-    return *this - Rational(x);
+  Rational operator-(const BigInteger &x) const & {
+    Rational result = *this;
+    return result -= x;
+  }
+
+  Rational operator-(const BigInteger &x) && {
+    return std::move(*this -= x);
   }
   Rational &operator*=(const BigInteger &x) {
-    return *this *= Rational(x);
+    if (Q == 1) {
+      P *= x;
+      return *this;
+    }
+    BigInteger GCD = gcd(x, Q);
+    if (GCD == 1) {
+      P *= x;
+    } else {
+      P *= x / GCD;
+      Q /= GCD;
+    }
+    return *this;
   }
-  Rational operator*(const BigInteger &x) const {
-    return *this * Rational(x);
+  Rational operator*(const BigInteger &x) const & {
+    Rational result = *this;
+    return result *= x;
+  }
+
+  Rational operator*(const BigInteger &x) && {
+    return std::move(*this *= x);
   }
 
   Rational &operator/=(const BigInteger &x) {
-    return *this /= Rational(x);
+    BigInteger GCD = gcd(P, x);
+    if (GCD == 1) {
+      Q *= x;
+    } else {
+      P /= GCD;
+      Q *= x / GCD;
+    }
+    if (Q < 0) {
+      P.flip_sign();
+      Q.flip_sign();
+    }
+    return *this;
   }
-  Rational operator/(const BigInteger &x) const {
+  Rational operator/(const BigInteger &x) const & {
     Rational result = *this;
     return result /= x;
   }
 
+  Rational operator/(const BigInteger &x) && {
+    return std::move(*this /= x);
+  }
+
   bool operator==(const BigInteger &x) const {
-    return (*this == Rational(x));
+    if (Q == 1) return P == x;
+    return !reduced && P.compare_product(Q, x) == 0;
   }
 
   bool operator!=(const BigInteger &x) const {
@@ -594,52 +3064,86 @@ class Rational {
   }
 
   bool operator<(const BigInteger &x) const {
-    return *this < Rational(x);
+    return Q == 1 ? P < x : P.compare_product(Q, x) < 0;
   }
 
   bool operator>(const BigInteger &x) const {
-    return Rational(x) < *this;
+    return Q == 1 ? x < P : P.compare_product(Q, x) > 0;
   }
 
   bool operator<=(const BigInteger &x) const {
-    return !(Rational(x) < *this);
+    return !(*this > x);
   }
 
   bool operator>=(const BigInteger &x) const {
-    return !(*this < Rational(x));
+    return !(*this < x);
   }
 
   Rational &operator+=(int x) {
-    return *this += Rational(x);
+    if (Q == 1) {
+      P += x;
+    } else {
+      P += Q * x;
+    }
+    return *this;
+  }
+
+  Rational operator+(int x) const & {
+    Rational result = *this;
+    return result += x;
   }
 
-  Rational operator+(int x) const {
-    return *this + Rational(x);
+  Rational operator+(int x) && {
+    return std::move(*this += x);
   }
   Rational &operator-=(int x) {
-    return *this -= Rational(x);
+    if (Q == 1) {
+      P -= x;
+    } else {
+      P -= Q * x;
+    }
+    return *this;
+  }
+
+  Rational operator-(int x) const & {
+    Rational result = *this;
+    return result -= x;
   }
 
-  Rational operator-(int x) const {
-    return *this - Rational(x);
+  Rational operator-(int x) && {
+    return std::move(*this -= x);
   }
   Rational &operator*=(int x) {
-    return *this *= Rational(x);
+    if (Q == 1) {
+      P *= x;
+      return *this;
+    }
+    return *this *= BigInteger(x);
+  }
+  Rational operator*(int x) const & {
+    Rational result = *this;
+    return result *= x;
   }
-  Rational operator*(int x) const {
-    return *this * Rational(x);
+
+  Rational operator*(int x) && {
+    return std::move(*this *= x);
   }
 
   Rational &operator/=(int x) {
-    return *this /= Rational(x);
+    return *this /= BigInteger(x);
   }
-  Rational operator/(int x) const {
+  Rational operator/(int x) const & {
     Rational result = *this;
     return result /= x;
   }
 
+  Rational operator/(int x) && {
+    return std::move(*this /= x);
+  }
+
   bool operator==(int x) const {
-    return (*this == Rational(x));
+    if (Q == 1) return P == x;
+    return !reduced && P.compare_product(Q, x) == 0;
   }
 
   bool operator!=(int x) const {
@@ -647,127 +3151,325 @@ class Rational {
   }
 
   bool operator<(int x) const {
-    return *this < Rational(x);
+    return Q == 1 ? P < x : P.compare_product(Q, x) < 0;
   }
 
   bool operator>(int x) const {
-    return Rational(x) < *this;
+    return Q == 1 ? P > x : P.compare_product(Q, x) > 0;
   }
 
   bool operator<=(int x) const {
-    return !(Rational(x) < *this);
+    return !(*this > x);
   }
 
   bool operator>=(int x) const {
-    return !(*this < Rational(x));
+    return !(*this < x);
   }
   std::string toString() const {
+    if (!reduced) {
+      Rational copy = *this;
+      copy.normalize();
+      return copy.toString();
+    }
     if (Q == 1) return P.toString();
     return P.toString() + '/' + Q.toString();
   }
 
   std::string asDecimal(size_t precision = 0) const {
     std::string result;
-    if (P < 0 && -P <= Q) {
-      result.push_back('-');
-    }
-    result += (P / Q).toString();
-    if (precision == 0) return result;
-    result += '.';
-    BigInteger after_point = (P.addition_pow(precision) / Q - (P / Q).addition_pow(precision));
-    if (P < 0) {
-      after_point.flip_sign();
-    }
-    int num_null = precision - after_point.length();
-    for (int i = 0; i < num_null; ++i) {
-      result.push_back('0');
-    }
-    result += after_point.toString();
+    write_decimal(precision, [&result](const std::string &part) { result += part; });
     return result;
   }
 
+  // Streams the digits of asDecimal(precision) into `out` as they are produced.
+  std::ostream &asDecimal(std::ostream &out, size_t precision) const {
+    write_decimal(precision, [&out](const std::string &part) { out << part; });
+    return out;
+  }
+
+  // The nearest double (float), ties to even, including subnormals and infinities.
+  double to_double() const {
+    return to_floating<double>();
+  }
+
+  float to_float() const {
+    return to_floating<float>();
+  }
+
   operator double() const {
-    return std::stod(asDecimal(20));
+    return to_double();
   }
 
  private:
   BigInteger P;
   BigInteger Q;
+  bool reduced = true;
+
+  friend class BigIntegerWriter;
+  friend class BigIntegerReader;
+
+  static inline bool lazy_normalization = false;
+  static inline size_t lazy_threshold = 1000;
  private:
   void fix() {
-    BigInteger GCD = gcd(P, Q);
-    P /= GCD;
-    Q /= GCD;
+    if (lazy_normalization && P.length() + Q.length() < lazy_threshold) {
+      reduced = false;
+      return;
+    }
+    reduced = false;
+    normalize();
+  }
+
+  // Compares P1/Q1 with P2/Q2 (denominators are positive): by signs first, then by the digit
+  // counts of the cross products, and multiplies only when those do not decide, into scratch.
+  static bool less(const BigInteger &P1, const BigInteger &Q1, const BigInteger &P2, const BigInteger &Q2) {
+    int sign1 = P1.signum();
+    int sign2 = P2.signum();
+    if (sign1 != sign2) return sign1 < sign2;
+    if (sign1 == 0) return false;
+    if (Q1 == Q2) return P1 < P2;
+    long long p1, q1, p2, q2;
+    if (P1.to_int64(p1) && Q1.to_int64(q1) && P2.to_int64(p2) && Q2.to_int64(q2)) {
+      return __int128(p1) * q2 < __int128(p2) * q1;
+    }
+    size_t left = P1.length() + Q2.length();
+    size_t right = P2.length() + Q1.length();
+    if (left + 1 < right) return sign1 > 0;
+    if (right + 1 < left) return sign1 < 0;
+    biginteger_detail::ScratchScope scratch;
+    std::vector<int> &left_product = scratch.vector();
+    std::vector<int> &right_product = scratch.vector();
+    BigInteger::multiply(left_product, P1.number, Q2.number);
+    BigInteger::multiply(right_product, P2.number, Q1.number);
+    BigInteger::trim(left_product);
+    BigInteger::trim(right_product);
+    int abs_compare = BigInteger::compare_abs(left_product, right_product);
+    return sign1 > 0 ? abs_compare < 0 : abs_compare > 0;
+  }
+
+  // Digits after the point come from long division of the remainder, one chunk per division.
+  // The first chunks are as long as Q, then every chunk matches all digits written so far, so
+  // the first digits arrive early and the whole expansion takes a logarithmic number of
+  // divisions. Digits are truncated, not rounded.
+  template<typename Sink>
+  void write_decimal(size_t precision, Sink sink) const {
+    BigInteger integer;
+    BigInteger rest;
+    divmod(P, Q, integer, rest);
+    if (P < 0 && !integer) sink("-");
+    sink(integer.toString());
+    if (precision == 0) return;
+    sink(".");
+    if (rest < 0) rest.flip_sign();
+    size_t written = 0;
+    size_t chunk = std::max<size_t>(9, Q.length());
+    BigInteger digits;
+    while (precision > 0) {
+      size_t count = std::max(chunk, written);
+      // A short tail is merged into the last chunk instead of costing a division of its own.
+      if (precision < 2 * count) count = precision;
+      rest = rest.addition_pow(count);
+      divmod(rest, Q, digits, rest);
+      std::string text = digits.toString();
+      sink(std::string(count - text.size(), '0') + text);
+      precision -= count;
+      written += count;
+    }
   }
 
-  BigInteger gcd(BigInteger N, BigInteger M) const {
-    while (M != 0) {
-      BigInteger tmp = N % M;
-      N = M;
-      M = tmp;
+  // |P| * 2^shift / |Q| is formed with about 57 bits, enough for any mantissa plus a guard bit;
+  // the remainder of that single division acts as the sticky bit for rounding.
+  template<typename Float>
+  Float to_floating() const {
+    using limits = std::numeric_limits<Float>;
+    if (!P) return Float(0);
+    bool negative = (P < 0) != (Q < 0);
+    double log2 = (P.log10() - Q.log10()) * 3.321928094887362;
+    if (log2 > limits::max_exponent + 1) {
+      return negative ? -limits::infinity() : limits::infinity();
+    }
+    if (log2 < limits::min_exponent - limits::digits - 3) {
+      return negative ? -Float(0) : Float(0);
+    }
+    const long long target_bits = 57;
+    long long shift = target_bits - std::llround(log2);
+    long long q = 0;
+    int bits = 0;
+    bool sticky = false;
+    while (true) {
+      BigInteger quotient;
+      BigInteger rest;
+      // Left shifts are exact, so the signs can stay in place; only |quotient| is used.
+      if (shift >= 0) {
+        divmod(P << size_t(shift), Q, quotient, rest);
+      } else {
+        divmod(P, Q << size_t(-shift), quotient, rest);
+      }
+      // The estimate of log2 is off by at most a bit or two; retry with a corrected shift.
+      if (!quotient.to_int64(q)) {
+        shift -= 4;
+        continue;
+      }
+      if (q < 0) q = -q;
+      bits = q ? 64 - __builtin_clzll(q) : 0;
+      if (bits <= limits::digits + 1) {
+        shift += target_bits - bits;
+        continue;
+      }
+      sticky = bool(rest);
+      break;
     }
-    return (N < 0 ? -N : N);
+    long long exponent = bits - 1 - shift;
+    long long precision = limits::digits;
+    if (exponent < limits::min_exponent - 1) precision -= limits::min_exponent - 1 - exponent;
+    if (precision < 0) return negative ? -Float(0) : Float(0);
+    int drop = bits - int(precision);
+    unsigned long long low = q & ((1ull << drop) - 1);
+    unsigned long long half = 1ull << (drop - 1);
+    q >>= drop;
+    if (low > half || (low == half && (sticky || (q & 1)))) ++q;
+    Float result = std::ldexp(Float(q), int(drop - shift));
+    return negative ? -result : result;
+  }
+
+  void normalize() {
+    if (reduced) return;
+    reduced = true;
+    if (Q == 1) return;
+    BigInteger GCD = gcd(P, Q);
+    if (GCD == 1) return;
+    P /= GCD;
+    Q /= GCD;
   }
 
 };
 
 Rational operator+(int x, const Rational &other) {
-  return Rational(x) + other;
+  Rational result = other;
+  return result += x;
 }
 Rational operator-(int x, const Rational &other) {
-  return Rational(x) - other;
+  Rational result = other;
+  result -= x;
+  return -std::move(result);
 }
 Rational operator*(int x, const Rational &other) {
-  return Rational(x) * other;
+  Rational result = other;
+  return result *= x;
 }
 Rational operator/(int x, const Rational &other) {
   return Rational(x) / other;
 }
 bool operator<(int x, const Rational &other) {
-  return Rational(x) < other;
+  return other > x;
 }
 bool operator>(int x, const Rational &other) {
-  return Rational(x) > other;
+  return other < x;
 }
 bool operator>=(int x, const Rational &other) {
-  return Rational(x) >= other;
+  return other <= x;
 }
 bool operator<=(int x, const Rational &other) {
-  return Rational(x) <= other;
+  return other >= x;
 }
 bool operator==(int x, const Rational &other) {
-  return Rational(x) == other;
+  return other == x;
 }
 bool operator!=(int x, const Rational &other) {
-  return Rational(x) != other;
+  return other != x;
 }
 Rational operator+(const BigInteger &x, const Rational &other) {
-  return Rational(x) + other;
+  Rational result = other;
+  return result += x;
 }
 Rational operator-(const BigInteger &x, const Rational &other) {
-  return Rational(x) - other;
+  Rational result = other;
+  result -= x;
+  return -std::move(result);
 }
 Rational operator*(const BigInteger &x, const Rational &other) {
-  return Rational(x) * other;
+  Rational result = other;
+  return result *= x;
 }
 Rational operator/(const BigInteger &x, const Rational &other) {
   return Rational(x) / other;
 }
 bool operator<(const BigInteger &x, const Rational &other) {
-  return Rational(x) < other;
+  return other > x;
 }
 bool operator>(const BigInteger &x, const Rational &other) {
-  return Rational(x) > other;
+  return other < x;
 }
 bool operator>=(const BigInteger &x, const Rational &other) {
-  return Rational(x) >= other;
+  return other <= x;
 }
 bool operator<=(const BigInteger &x, const Rational &other) {
-  return Rational(x) <= other;
+  return other >= x;
 }
 bool operator==(const BigInteger &x, const Rational &other) {
-  return Rational(x) == other;
+  return other == x;
 }
 bool operator!=(const BigInteger &x, const Rational &other) {
-  return Rational(x) != other;
+  return other != x;
 }
+
+// Batches of BigInteger and Rational values in the binary format: one version byte, then the
+// records back to back (a Rational is its numerator record followed by its denominator record,
+// stored as they are, possibly not yet reduced).
+class BigIntegerWriter {
+ public:
+  explicit BigIntegerWriter(std::ostream &out) : out(out) {
+    out.put(char(BigInteger::binary_format_version));
+  }
+
+  void write(const BigInteger &x) {
+    x.write_binary(out);
+  }
+
+  void write(const Rational &x) {
+    x.P.write_binary(out);
+    x.Q.write_binary(out);
+  }
+
+  template<typename Iterator>
+  void write(Iterator first, Iterator last) {
+    for (; first != last; ++first) write(*first);
+  }
+
+ private:
+  std::ostream &out;
+};
+
+class BigIntegerReader {
+ public:
+  explicit BigIntegerReader(std::istream &in) : in(in) {
+    int version = in.get();
+    if (version != BigInteger::binary_format_version) {
+      throw std::invalid_argument("unsupported BigInteger binary format version");
+    }
+  }
+
+  // Fills `x` in place, reusing its storage; returns false at the end of the stream.
+  bool read(BigInteger &x) {
+    return x.read_binary(in);
+  }
+
+  bool read(Rational &x) {
+    if (!x.P.read_binary(in)) return false;
+    if (!x.Q.read_binary(in) || x.Q.signum() <= 0) {
+      throw std::invalid_argument("malformed Rational record");
+    }
+    x.reduced = false;
+    return true;
+  }
+
+  // Reads into the existing values of [first, last) and returns the end of what was filled.
+  template<typename Iterator>
+  Iterator read(Iterator first, Iterator last) {
+    while (first != last && read(*first)) ++first;
+    return first;
+  }
+
+ private:
+  std::istream &in;
+};
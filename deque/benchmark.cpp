@@ -0,0 +1,659 @@
+// Benchmarks for Deque, with std::deque as the reference where there is one. Every line of
+// output is a JSON object: the benchmark, its parameters and the seconds per operation.
+//
+//   g++ -O2 -std=c++17 -pthread benchmark.cpp -o benchmark
+//   (GCC vectorizes most of the segmented:: loops only from -O3 on.)
+//   ./benchmark [name...]    runs the named benchmarks, all of them by default
+//
+// SOAK_OPERATIONS in the environment sets the length of the fifo_soak run (10^9 by default),
+// PARALLEL_SIZE the deque size of the parallel run (10^7 by default).
+
+#include "deque.cpp"
+#include "spsc_queue.cpp"
+#include "parallel_algorithms.cpp"
+#include "thread_pool.cpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+std::atomic<size_t> allocations{0};
+std::atomic<size_t> live_bytes{0};
+
+// Every allocation carries its size in front of it, so that live_bytes can be kept up to date.
+constexpr size_t header_size = alignof(std::max_align_t);
+
+void Release(void *memory) {
+    if (memory != nullptr) {
+        void *block = reinterpret_cast<void *>(reinterpret_cast<uintptr_t>(memory) - header_size);
+        live_bytes.fetch_sub(*static_cast<size_t *>(block), std::memory_order_relaxed);
+        std::free(block);
+    }
+}
+
+}  // namespace
+
+void *operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (char *block = static_cast<char *>(std::malloc(size + header_size))) {
+        *reinterpret_cast<size_t *>(block) = size;
+        live_bytes.fetch_add(size, std::memory_order_relaxed);
+        return block + header_size;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *memory) noexcept {
+    Release(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept {
+    Release(memory);
+}
+
+void operator delete[](void *memory) noexcept {
+    Release(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept {
+    Release(memory);
+}
+
+namespace {
+
+double now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Random-position insert followed by a random-position erase, on a container of `size` ints.
+template<typename Container>
+double InsertErase(size_t size, size_t operations) {
+    Container container;
+    for (size_t i = 0; i < size; ++i) {
+        container.push_back(int(i));
+    }
+    std::mt19937_64 rng(1);
+    double start = now();
+    for (size_t i = 0; i < operations; ++i) {
+        container.insert(container.begin() + rng() % (container.size() + 1), int(i));
+        container.erase(container.begin() + rng() % container.size());
+    }
+    return (now() - start) / (2 * operations);
+}
+
+void BenchmarkInsert() {
+    const size_t size = 1000000;
+    const size_t operations = 2000;
+    double deque = InsertErase<Deque<int>>(size, operations);
+    double std_deque = InsertErase<std::deque<int>>(size, operations);
+    std::printf("{\"benchmark\": \"insert\", \"size\": %zu, \"operations\": %zu, \"seconds\": %.6e, "
+                "\"std_seconds\": %.6e}\n", size, 2 * operations, deque, std_deque);
+}
+
+// Sums `size` ints three ways: at random indices, with operator[] in order and with iterators.
+template<typename Container>
+void Access(const char *name, size_t size_bucket) {
+    const size_t size = 10000000;
+    Container container;
+    for (size_t i = 0; i < size; ++i) {
+        container.push_back(int(i));
+    }
+    std::vector<uint32_t> indices(size);
+    std::mt19937 rng(1);
+    for (uint32_t &index : indices) {
+        index = rng() % size;
+    }
+    long long sum = 0;
+    double start = now();
+    for (uint32_t index : indices) {
+        sum += container[index];
+    }
+    double random = (now() - start) / size;
+    start = now();
+    for (size_t i = 0; i < size; ++i) {
+        sum += container[i];
+    }
+    double indexed = (now() - start) / size;
+    start = now();
+    for (auto it = container.begin(); it != container.end(); ++it) {
+        sum += *it;
+    }
+    double iterated = (now() - start) / size;
+    std::printf("{\"benchmark\": \"access\", \"container\": \"%s\", \"size_bucket\": %zu, \"size\": %zu, "
+                "\"random_seconds\": %.6e, \"indexed_seconds\": %.6e, \"iterated_seconds\": %.6e, \"sum\": %lld}\n",
+                name, size_bucket, size, random, indexed, iterated, sum);
+}
+
+template<size_t... SizeBuckets>
+void AccessAcrossBlockSizes(std::index_sequence<SizeBuckets...>) {
+    (Access<Deque<int, SizeBuckets>>("Deque", SizeBuckets), ...);
+}
+
+void BenchmarkAccess() {
+    AccessAcrossBlockSizes(std::index_sequence<16, 32, 64, 128, 256, 512, 1024>());
+    Access<std::deque<int>>("std::deque", 128);
+}
+
+// Steady-state queues of ints: a FIFO of `length` elements (push_back then pop_front), and a
+// stack whose size sits on a block boundary (push_back then pop_back).
+template<typename Container>
+void SteadyState(const char *name, Container &&container, size_t length) {
+    const size_t operations = 10000000;
+    for (size_t i = 0; i < length; ++i) {
+        container.push_back(int(i));
+    }
+    size_t allocations_before = allocations.load();
+    double start = now();
+    for (size_t i = 0; i < operations; ++i) {
+        container.push_back(int(i));
+        container.pop_front();
+    }
+    double fifo = (now() - start) / (2 * operations);
+    size_t fifo_allocations = allocations.load() - allocations_before;
+    allocations_before = allocations.load();
+    start = now();
+    for (size_t i = 0; i < operations; ++i) {
+        container.push_back(int(i));
+        container.pop_back();
+    }
+    double boundary = (now() - start) / (2 * operations);
+    size_t boundary_allocations = allocations.load() - allocations_before;
+    std::printf("{\"benchmark\": \"steady_state\", \"container\": \"%s\", \"length\": %zu, "
+                "\"fifo_seconds\": %.6e, \"fifo_allocations_per_operation\": %.6f, "
+                "\"boundary_seconds\": %.6e, \"boundary_allocations_per_operation\": %.6f}\n", name, length, fifo,
+                double(fifo_allocations) / (2 * operations), boundary, double(boundary_allocations) / (2 * operations));
+}
+
+void BenchmarkSteadyState() {
+    const size_t length = 1024;
+    SteadyState("Deque", Deque<int>(), length);
+    Deque<int> uncached;
+    uncached.set_spare_block_limit(0);
+    SteadyState("Deque without spare blocks", std::move(uncached), length);
+    SteadyState("std::deque", std::deque<int>(), length);
+}
+
+// A FIFO of `length` ints pushed through the deque for a long time: the memory it holds (block
+// map and blocks) is sampled at every power of ten of operations and has to stay flat.
+void BenchmarkFifoSoak() {
+    const size_t length = 1024;
+    const char *setting = std::getenv("SOAK_OPERATIONS");
+    const size_t operations = setting != nullptr ? std::strtoull(setting, nullptr, 10) : 1000000000;
+    size_t bytes_before = live_bytes.load();
+    Deque<int> deque;
+    for (size_t i = 0; i < length; ++i) {
+        deque.push_back(int(i));
+    }
+    size_t allocations_before = allocations.load();
+    double start = now();
+    size_t sample = 1000;
+    for (size_t done = 2; done <= operations; done += 2) {
+        deque.push_back(int(done));
+        deque.pop_front();
+        if (done >= sample || done + 2 > operations) {
+            std::printf("{\"benchmark\": \"fifo_soak\", \"length\": %zu, \"operations\": %zu, \"bytes\": %zu, "
+                        "\"allocations\": %zu, \"seconds_per_operation\": %.6e}\n", length, done,
+                        live_bytes.load() - bytes_before, allocations.load() - allocations_before,
+                        (now() - start) / done);
+            std::fflush(stdout);
+            sample *= 10;
+        }
+    }
+}
+
+// The handoff queue SpscQueue replaces: a Deque behind a mutex, with the same interface.
+class LockedDeque {
+public:
+    bool try_push(int item) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        deque_.push_back(item);
+        return true;
+    }
+
+    bool try_pop(int &item) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (deque_.size() == 0) {
+            return false;
+        }
+        item = deque_[0];
+        deque_.pop_front();
+        return true;
+    }
+
+    size_t try_push_bulk(const int *first, size_t count) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < count; ++i) {
+            deque_.push_back(first[i]);
+        }
+        return count;
+    }
+
+    size_t try_pop_bulk(int *out, size_t max_count) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t count = std::min(max_count, deque_.size());
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = deque_[0];
+            deque_.pop_front();
+        }
+        return count;
+    }
+
+private:
+    std::mutex mutex_;
+    Deque<int> deque_;
+};
+
+// One thread pushes `count` ints while another pops them, one at a time or `batch` at a time;
+// both yield whenever the queue is full or empty.
+template<typename Queue>
+double Transfer(Queue &queue, size_t count, size_t batch) {
+    long long sum = 0;
+    double start = now();
+    std::thread producer([&queue, count, batch] {
+        std::vector<int> items(batch);
+        for (size_t sent = 0; sent < count;) {
+            size_t pushed;
+            if (batch == 1) {
+                pushed = queue.try_push(int(sent)) ? 1 : 0;
+            } else {
+                for (size_t i = 0; i < batch; ++i) {
+                    items[i] = int(sent + i);
+                }
+                pushed = queue.try_push_bulk(items.data(), std::min(batch, count - sent));
+            }
+            sent += pushed;
+            if (pushed == 0) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    std::vector<int> items(batch);
+    for (size_t received = 0; received < count;) {
+        size_t popped;
+        if (batch == 1) {
+            popped = queue.try_pop(items[0]) ? 1 : 0;
+        } else {
+            popped = queue.try_pop_bulk(items.data(), batch);
+        }
+        for (size_t i = 0; i < popped; ++i) {
+            sum += items[i];
+        }
+        received += popped;
+        if (popped == 0) {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    double seconds = (now() - start) / count;
+    if (sum != (long long) count * (long long) (count - 1) / 2) {
+        std::printf("{\"error\": \"lost elements\"}\n");
+    }
+    return seconds;
+}
+
+// Round trips of one int through a pair of queues, each thread waiting for the other's reply.
+template<typename Queue>
+double RoundTrip(size_t count) {
+    Queue there, back;
+    double start = now();
+    std::thread echo([&there, &back, count] {
+        int item;
+        for (size_t i = 0; i < count; ++i) {
+            while (!there.try_pop(item)) {
+                std::this_thread::yield();
+            }
+            back.try_push(item);
+        }
+    });
+    int item;
+    for (size_t i = 0; i < count; ++i) {
+        there.try_push(int(i));
+        while (!back.try_pop(item)) {
+            std::this_thread::yield();
+        }
+    }
+    echo.join();
+    return (now() - start) / count;
+}
+
+template<typename Queue>
+void Handoff(const char *name) {
+    const size_t count = 10000000;
+    const size_t batch = 64;
+    const size_t round_trips = 100000;
+    Queue single, bulk;
+    double single_seconds = Transfer(single, count, 1);
+    double bulk_seconds = Transfer(bulk, count, batch);
+    double round_trip = RoundTrip<Queue>(round_trips);
+    std::printf("{\"benchmark\": \"spsc\", \"queue\": \"%s\", \"count\": %zu, \"seconds_per_item\": %.6e, "
+                "\"batch\": %zu, \"bulk_seconds_per_item\": %.6e, \"round_trip_seconds\": %.6e, "
+                "\"hardware_threads\": %u}\n", name, count, single_seconds, batch, bulk_seconds, round_trip,
+                std::thread::hardware_concurrency());
+}
+
+void BenchmarkSpsc() {
+    Handoff<SpscQueue<int>>("SpscQueue");
+    Handoff<LockedDeque>("Deque + std::mutex");
+}
+
+long long SerialFib(int n) {
+    return n < 2 ? n : SerialFib(n - 1) + SerialFib(n - 2);
+}
+
+// Forks fib(n - 1) and computes fib(n - 2) itself, down to `cutoff`.
+long long ParallelFib(ThreadPool &pool, int n, int cutoff) {
+    if (n < cutoff) {
+        return SerialFib(n);
+    }
+    long long first = 0;
+    WaitGroup group;
+    pool.submit(group, [&pool, &first, n, cutoff] {
+        first = ParallelFib(pool, n - 1, cutoff);
+    });
+    long long second = ParallelFib(pool, n - 2, cutoff);
+    pool.wait(group);
+    return first + second;
+}
+
+// Quicksort that forks the upper part of every partition until pieces are small enough for std::sort.
+void SortPiece(ThreadPool &pool, WaitGroup &group, int *first, int *last) {
+    const ptrdiff_t cutoff = 1 << 14;
+    while (last - first > cutoff) {
+        int pivot = std::max(std::min(first[0], first[(last - first) / 2]),
+                             std::min(std::max(first[0], first[(last - first) / 2]), last[-1]));
+        int *lower = std::partition(first, last, [pivot](int x) { return x < pivot; });
+        int *upper = std::partition(lower, last, [pivot](int x) { return !(pivot < x); });
+        pool.submit(group, [&pool, &group, upper, last] {
+            SortPiece(pool, group, upper, last);
+        });
+        last = lower;
+    }
+    std::sort(first, last);
+}
+
+void ParallelSort(ThreadPool &pool, int *first, int *last) {
+    WaitGroup group;
+    SortPiece(pool, group, first, last);
+    pool.wait(group);
+}
+
+// Fork-join recursion on pools of 1, 2, 4, ... threads up to the hardware's, against the serial code.
+void BenchmarkForkJoin() {
+    const int fib_n = 32;
+    const int fib_cutoff = 16;
+    const size_t sort_size = 10000000;
+    std::vector<int> input(sort_size);
+    std::mt19937 rng(1);
+    for (int &x : input) {
+        x = int(rng());
+    }
+    double start = now();
+    long long expected = SerialFib(fib_n);
+    double serial_fib = now() - start;
+    std::vector<int> sorted = input;
+    start = now();
+    std::sort(sorted.begin(), sorted.end());
+    double serial_sort = now() - start;
+    size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t threads = 1;; threads = std::min(threads * 2, hardware)) {
+        ThreadPool pool(threads);
+        start = now();
+        long long fib = ParallelFib(pool, fib_n, fib_cutoff);
+        double fib_seconds = now() - start;
+        std::vector<int> data = input;
+        start = now();
+        ParallelSort(pool, data.data(), data.data() + data.size());
+        double sort_seconds = now() - start;
+        std::printf("{\"benchmark\": \"fork_join\", \"threads\": %zu, \"hardware_threads\": %zu, "
+                    "\"fib_n\": %d, \"fib_seconds\": %.6e, \"fib_speedup\": %.3f, \"sort_size\": %zu, "
+                    "\"sort_seconds\": %.6e, \"sort_speedup\": %.3f, \"correct\": %s}\n", threads, hardware,
+                    fib_n, fib_seconds, serial_fib / fib_seconds, sort_size, sort_seconds, serial_sort / sort_seconds,
+                    fib == expected && data == sorted ? "true" : "false");
+        std::fflush(stdout);
+        if (threads == hardware) {
+            break;
+        }
+    }
+}
+
+// Seconds per element of `run` over `size` elements, best of five passes of about 10^7 elements.
+template<typename Run>
+double PerElement(size_t size, Run run) {
+    size_t repeats = std::max<size_t>(10000000 / size, 1);
+    double best = 1e9;
+    for (int pass = 0; pass < 5; ++pass) {
+        double start = now();
+        for (size_t i = 0; i < repeats; ++i) {
+            run();
+        }
+        best = std::min(best, (now() - start) / (size * repeats));
+    }
+    return best;
+}
+
+void ReportSegments(const char *algorithm, size_t size, double iterator, double segmented) {
+    std::printf("{\"benchmark\": \"segments\", \"algorithm\": \"%s\", \"size\": %zu, "
+                "\"iterator_seconds\": %.6e, \"segmented_seconds\": %.6e, \"speedup\": %.2f}\n", algorithm, size,
+                iterator, segmented, iterator / segmented);
+}
+
+// The standard algorithms over Deque iterators against their segmented:: versions, on ints that
+// fit in cache and on ones that do not.
+void BenchmarkSegments() {
+    for (size_t size : {size_t(16384), size_t(10000000)}) {
+        Deque<int> deque;
+        for (size_t i = 0; i < size; ++i) {
+            deque.push_back(int(i % 1000));
+        }
+        std::vector<int> out(size);
+        long long sink = 0;
+
+        double iterator = PerElement(size, [&] { sink += std::accumulate(deque.begin(), deque.end(), 0LL); });
+        double segments = PerElement(size, [&] { sink += segmented::accumulate(deque.segments(), 0LL); });
+        ReportSegments("accumulate", size, iterator, segments);
+
+        iterator = PerElement(size, [&] { std::copy(deque.begin(), deque.end(), out.begin()); });
+        segments = PerElement(size, [&] { segmented::copy(deque.segments(), out.begin()); });
+        ReportSegments("copy", size, iterator, segments);
+
+        iterator = PerElement(size, [&] { std::fill(deque.begin(), deque.end(), 7); });
+        segments = PerElement(size, [&] { segmented::fill(deque.segments(), 7); });
+        ReportSegments("fill", size, iterator, segments);
+
+        iterator = PerElement(size, [&] { sink += std::find(deque.begin(), deque.end(), -1) - deque.begin(); });
+        segments = PerElement(size, [&] { sink += segmented::find(deque.segments(), -1) - deque.begin(); });
+        ReportSegments("find", size, iterator, segments);
+
+        iterator = PerElement(size, [&] { std::for_each(deque.begin(), deque.end(), [](int &x) { x += 3; }); });
+        segments = PerElement(size, [&] { segmented::for_each(deque.segments(), [](int &x) { x += 3; }); });
+        ReportSegments("for_each", size, iterator, segments);
+
+        if (sink == 42 && out[0] == 42) {
+            std::printf("\n");
+        }
+    }
+}
+
+// Strong scaling of the parallel:: algorithms on one deque of ints, for 1, 2, 4, ... threads up
+// to the hardware's; the speedup is against the single-thread (serial) run.
+void BenchmarkParallel() {
+    const char *setting = std::getenv("PARALLEL_SIZE");
+    const size_t size = setting != nullptr ? std::strtoull(setting, nullptr, 10) : 10000000;
+    std::vector<int> input(size);
+    std::mt19937 rng(1);
+    for (int &x : input) {
+        x = int(rng() % 1000000);
+    }
+    const char *names[] = {"for_each", "transform", "reduce", "sort", "stable_sort"};
+    double serial[5] = {};
+    size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t threads = 1;; threads = std::min(threads * 2, hardware)) {
+        parallel::set_parallelism(unsigned(threads));
+        Deque<int> deque;
+        for (int x : input) {
+            deque.push_back(x);
+        }
+        Deque<long long> out(int64_t(deque.size()));
+        double seconds[5];
+        double start = now();
+        parallel::for_each(deque, [](int &x) { x = x * 7 % 1000003; });
+        seconds[0] = now() - start;
+        start = now();
+        parallel::transform(deque, out, [](int x) { return (long long) x * x; });
+        seconds[1] = now() - start;
+        start = now();
+        long long sum = parallel::reduce(deque, 0LL);
+        seconds[2] = now() - start;
+        Deque<int> copy = deque;
+        start = now();
+        parallel::sort(deque);
+        seconds[3] = now() - start;
+        start = now();
+        parallel::stable_sort(copy, [](int a, int b) { return a % 1000 < b % 1000; });
+        seconds[4] = now() - start;
+        bool sorted = std::is_sorted(deque.begin(), deque.end()) &&
+                      std::is_sorted(copy.begin(), copy.end(), [](int a, int b) { return a % 1000 < b % 1000; });
+        for (int i = 0; i < 5; ++i) {
+            if (threads == 1) {
+                serial[i] = seconds[i];
+            }
+            std::printf("{\"benchmark\": \"parallel\", \"algorithm\": \"%s\", \"size\": %zu, \"threads\": %zu, "
+                        "\"hardware_threads\": %zu, \"seconds\": %.6e, \"speedup\": %.3f", names[i], size, threads,
+                        hardware, seconds[i], serial[i] / seconds[i]);
+            if (i == 2) {
+                std::printf(", \"sum\": %lld", sum);
+            } else if (i >= 3) {
+                std::printf(", \"sorted\": %s", sorted ? "true" : "false");
+            }
+            std::printf("}\n");
+        }
+        std::fflush(stdout);
+        if (threads == hardware) {
+            break;
+        }
+    }
+}
+
+void ReportBulk(const char *operation, const char *type, size_t size, double push_back, double bulk) {
+    std::printf("{\"benchmark\": \"bulk\", \"operation\": \"%s\", \"type\": \"%s\", \"size\": %zu, "
+                "\"push_back_seconds\": %.6e, \"bulk_seconds\": %.6e, \"speedup\": %.2f}\n", operation, type, size,
+                push_back, bulk, push_back / bulk);
+}
+
+// Building a deque with the bulk operations against push_back one element at a time: from a
+// vector, as copies of one value, and as a copy of another deque.
+template<typename T>
+void Bulk(const char *type, const std::vector<T> &source) {
+    const size_t size = source.size();
+    size_t checksum = 0;
+    double push_back = PerElement(size, [&] {
+        Deque<T> deque;
+        for (const T &item : source) {
+            deque.push_back(item);
+        }
+        checksum += deque.size();
+    });
+    double bulk = PerElement(size, [&] {
+        Deque<T> deque(source.begin(), source.end());
+        checksum += deque.size();
+    });
+    ReportBulk("range", type, size, push_back, bulk);
+
+    push_back = PerElement(size, [&] {
+        Deque<T> deque;
+        for (size_t i = 0; i < size; ++i) {
+            deque.push_back(source[0]);
+        }
+        checksum += deque.size();
+    });
+    bulk = PerElement(size, [&] {
+        Deque<T> deque;
+        deque.append(size, source[0]);
+        checksum += deque.size();
+    });
+    ReportBulk("fill", type, size, push_back, bulk);
+
+    Deque<T> original(source.begin(), source.end());
+    push_back = PerElement(size, [&] {
+        Deque<T> deque;
+        for (const T &item : original) {
+            deque.push_back(item);
+        }
+        checksum += deque.size();
+    });
+    bulk = PerElement(size, [&] {
+        Deque<T> deque(original);
+        checksum += deque.size();
+    });
+    ReportBulk("copy", type, size, push_back, bulk);
+    if (checksum == 42) {
+        std::printf("\n");
+    }
+}
+
+void BenchmarkBulk() {
+    for (size_t size : {size_t(16384), size_t(10000000)}) {
+        std::vector<int> ints(size);
+        for (size_t i = 0; i < size; ++i) {
+            ints[i] = int(i);
+        }
+        Bulk("int", ints);
+    }
+    std::vector<std::string> strings(1000000);
+    for (size_t i = 0; i < strings.size(); ++i) {
+        strings[i] = std::to_string(i);
+    }
+    Bulk("std::string", strings);
+}
+
+struct Benchmark {
+    const char *name;
+    void (*run)();
+};
+
+const Benchmark benchmarks[] = {
+        {"insert", BenchmarkInsert},
+        {"access", BenchmarkAccess},
+        {"steady_state", BenchmarkSteadyState},
+        {"fifo_soak", BenchmarkFifoSoak},
+        {"spsc", BenchmarkSpsc},
+        {"fork_join", BenchmarkForkJoin},
+        {"segments", BenchmarkSegments},
+        {"parallel", BenchmarkParallel},
+        {"bulk", BenchmarkBulk},
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    for (const Benchmark &benchmark : benchmarks) {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc; ++i) {
+            selected = selected || std::strcmp(argv[i], benchmark.name) == 0;
+        }
+        if (selected) {
+            benchmark.run();
+            std::fflush(stdout);
+        }
+    }
+    return 0;
+}
@@ -1,83 +1,123 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
-template<typename T>
+namespace deque_detail {
+
+// Elements per block: the largest power of two whose block fits in 512 bytes, at least 16, so
+// that index / size and index % size compile to a shift and a mask.
+constexpr size_t DefaultSizeBucket(size_t element_size) {
+    size_t size = 16;
+    while (size * 2 * element_size <= 512) {
+        size *= 2;
+    }
+    return size;
+}
+
+// Iterators over elements that are contiguous in memory, which the bulk operations copy with memcpy.
+template<typename It, typename T>
+struct IsContiguous : std::integral_constant<bool,
+        std::is_same<It, T *>::value || std::is_same<It, const T *>::value ||
+        (!std::is_same<T, bool>::value && (std::is_same<It, typename std::vector<T>::iterator>::value ||
+                                           std::is_same<It, typename std::vector<T>::const_iterator>::value))> {
+};
+
+}  // namespace deque_detail
+
+template<typename T, size_t SizeBucket = deque_detail::DefaultSizeBucket(sizeof(T))>
 class Deque {
+    static_assert(SizeBucket > 0 && (SizeBucket & (SizeBucket - 1)) == 0, "the block size must be a power of two");
+
 public:
     Deque() {}
 
     Deque(int64_t count, const T &item) {
-        begin_ = (count + size_bucket_ - 1) / size_bucket_ * size_bucket_;
-        end_ = begin_ + count;
-        array_bucket_.resize((int64_t(end_) + size_bucket_ - 1) / size_bucket_, nullptr);
-        MemoryAllocation();
-        size_t id = begin_;
         try {
-            for (; id < end_; ++id) {
-                new(Pointer(id)) T(item);
-            }
+            append(count, item);
         } catch (...) {
-            for (size_t i = begin_; i < id; ++i) {
-                (Pointer(i))->~T();
-            }
             MemoryDelete();
-            begin_ = end_ = 0;
+            ReleaseSpareBuckets();
             throw;
         }
     }
 
     Deque(int64_t count) {
-        begin_ = (count + size_bucket_ - 1) / size_bucket_ * size_bucket_;
-        end_ = begin_ + count;
-        array_bucket_.resize((int64_t(end_) + size_bucket_ - 1) / size_bucket_, nullptr);
-        MemoryAllocation();
-        size_t id = begin_;
         try {
-            for (; id < end_; ++id) {
-                new(Pointer(id)) T();
-            }
+            AppendBlocks(count, [](T *out, size_t run) {
+                std::uninitialized_value_construct_n(out, run);
+            });
         } catch (...) {
-            for (size_t i = begin_; i < id; ++i) {
-                (Pointer(i))->~T();
-            }
             MemoryDelete();
-            begin_ = end_ = 0;
+            ReleaseSpareBuckets();
             throw;
         }
     }
 
-    Deque(const Deque<T> &other) {
-        begin_ = other.begin_;
-        end_ = other.end_;
-        array_bucket_.resize((end_ - 1) / size_bucket_ + 1, nullptr);
-        MemoryAllocation();
-        size_t id = begin_;
+    template<typename ForwardIt, typename = std::enable_if_t<!std::is_integral<ForwardIt>::value>>
+    Deque(ForwardIt first, ForwardIt last) {
         try {
-            for (; id < end_; ++id) {
-                new(Pointer(id)) T(*(other.Pointer(id)));
-            }
+            append(first, last);
         } catch (...) {
-            for (size_t i = begin_; i < id; ++i) {
-                (Pointer(i))->~T();
-            }
             MemoryDelete();
-            begin_ = end_ = 0;
+            ReleaseSpareBuckets();
             throw;
         }
     }
 
-    Deque &operator=(const Deque<T> &other) {
-        Deque<T> copy_deque(other);
+    // Starts at the same offset in a block as `other`, so that each of its segments fills
+    // exactly one block here.
+    Deque(const Deque &other) : spare_limit_(other.spare_limit_) {
+        if (other.size() > 0) {
+            begin_ = end_ = other.begin_ % size_bucket_;
+            array_bucket_.resize(1, nullptr);
+        }
+        auto segment = other.segments().begin();
+        try {
+            AppendBlocks(other.size(), [&segment](T *out, size_t run) {
+                CopyRun(out, (*segment).data, run);
+                ++segment;
+            });
+        } catch (...) {
+            MemoryDelete();
+            ReleaseSpareBuckets();
+            throw;
+        }
+    }
+
+    Deque(Deque &&other) noexcept
+            : array_bucket_(std::move(other.array_bucket_)), begin_(other.begin_), end_(other.end_),
+              spare_buckets_(std::move(other.spare_buckets_)), spare_limit_(other.spare_limit_) {
+        other.array_bucket_.clear();
+        other.spare_buckets_.clear();
+        other.begin_ = other.end_ = 0;
+    }
+
+    Deque &operator=(const Deque &other) {
+        Deque copy_deque(other);
         Swap(copy_deque);
         return *this;
     }
 
+    Deque &operator=(Deque &&other) noexcept {
+        Deque moved_deque(std::move(other));
+        Swap(moved_deque);
+        return *this;
+    }
+
     ~Deque() {
         for (size_t i = begin_; i < end_; ++i) {
             Pointer(i)->~T();
         }
         MemoryDelete();
+        ReleaseSpareBuckets();
     }
 
     T &operator[](int64_t index) {
@@ -104,57 +144,137 @@ public:
         return end_ - begin_;
     }
 
+    // Blocks freed by pops are kept for the next pushes, up to `limit` of them, so a deque whose
+    // size hovers around a block boundary does not go to the allocator on every operation.
+    void set_spare_block_limit(size_t limit) {
+        spare_buckets_.reserve(limit);
+        spare_limit_ = limit;
+        while (spare_buckets_.size() > spare_limit_) {
+            DeleteBucket(spare_buckets_.back());
+            spare_buckets_.pop_back();
+        }
+    }
+
+    size_t spare_block_limit() const {
+        return spare_limit_;
+    }
+
+    // Releases the spare blocks and shrinks the block map to the blocks in use.
+    void shrink_to_fit() {
+        ReleaseSpareBuckets();
+        spare_buckets_.shrink_to_fit();
+        Remap((end_ + size_bucket_ - 1) / size_bucket_ - begin_ / size_bucket_, 0);
+    }
+
+    // Appends [first, last) or `count` copies of `item`, allocating the blocks for all of them up
+    // front and filling them a block at a time (with memcpy/memset where T allows it). Strong
+    // guarantee: if anything throws, the deque is left as it was.
+    template<typename ForwardIt, typename = std::enable_if_t<!std::is_integral<ForwardIt>::value>>
+    void append(ForwardIt first, ForwardIt last) {
+        AppendBlocks(std::distance(first, last), [&first](T *out, size_t run) {
+            first = CopyRun(out, first, run);
+        });
+    }
+
+    void append(size_t count, const T &item) {
+        AppendBlocks(count, [&item](T *out, size_t run) {
+            FillRun(out, run, item);
+        });
+    }
+
+    template<typename ForwardIt, typename = std::enable_if_t<!std::is_integral<ForwardIt>::value>>
+    void assign(ForwardIt first, ForwardIt last) {
+        clear();
+        append(first, last);
+    }
+
+    void assign(size_t count, const T &item) {
+        T value(item);
+        clear();
+        append(count, value);
+    }
+
+    void clear() {
+        for (size_t i = begin_; i < end_; ++i) {
+            Pointer(i)->~T();
+        }
+        for (size_t i = begin_ / size_bucket_; i * size_bucket_ < end_; ++i) {
+            FreeBucket(array_bucket_[i]);
+            array_bucket_[i] = nullptr;
+        }
+        begin_ = end_ = array_bucket_.size() / 2 * size_bucket_;
+    }
+
     void push_back(const T &item) {
+        emplace_back(item);
+    }
+
+    void push_back(T &&item) {
+        emplace_back(std::move(item));
+    }
+
+    template<typename... Args>
+    T &emplace_back(Args &&... args) {
         if (end_ % size_bucket_ == 0) {
-            array_bucket_.push_back(reinterpret_cast<T *>(new int8_t[size_bucket_ * sizeof(T)]));
+            ReserveMap(0, 1);
+            array_bucket_[end_ / size_bucket_] = AllocateBucket();
         }
         try {
-            new(Pointer(end_)) T(item);
+            new(Pointer(end_)) T(std::forward<Args>(args)...);
         } catch (...) {
             if (end_ % size_bucket_ == 0) {
-                delete[] reinterpret_cast<int8_t *>(array_bucket_.back());
-                array_bucket_.pop_back();
+                FreeBucket(array_bucket_[end_ / size_bucket_]);
+                array_bucket_[end_ / size_bucket_] = nullptr;
             }
             throw;
         }
-        ++end_;
+        return *Pointer(end_++);
     }
 
     void pop_back() {
         (Pointer(end_ - 1))->~T();
         --end_;
         if (end_ % size_bucket_ == 0) {
-            delete[] reinterpret_cast<int8_t *>(array_bucket_.back());
-            array_bucket_.pop_back();
+            FreeBucket(array_bucket_[end_ / size_bucket_]);
+            array_bucket_[end_ / size_bucket_] = nullptr;
         }
     }
 
     void pop_front() {
         (Pointer(begin_))->~T();
         if ((begin_ + 1) % size_bucket_ == 0) {
-            delete[] reinterpret_cast <int8_t *>(array_bucket_[begin_ / size_bucket_]);
+            FreeBucket(array_bucket_[begin_ / size_bucket_]);
             array_bucket_[begin_ / size_bucket_] = nullptr;
         }
         ++begin_;
     }
 
     void push_front(const T &item) {
-        if (begin_ == 0) {
-            Resize();
-        }
+        emplace_front(item);
+    }
+
+    void push_front(T &&item) {
+        emplace_front(std::move(item));
+    }
+
+    template<typename... Args>
+    T &emplace_front(Args &&... args) {
         if (begin_ % size_bucket_ == 0) {
-            array_bucket_[begin_ / size_bucket_ - 1] = reinterpret_cast <T *> (new int8_t[size_bucket_ * sizeof(T)]);
+            ReserveMap(1, 0);
+            array_bucket_[begin_ / size_bucket_ - 1] = AllocateBucket();
         }
         --begin_;
         try {
-            new(Pointer(begin_)) T(item);
+            new(Pointer(begin_)) T(std::forward<Args>(args)...);
         } catch (...) {
             if ((begin_ + 1) % size_bucket_ == 0) {
-                delete[] reinterpret_cast <int8_t *>(array_bucket_[begin_ / size_bucket_]);
+                FreeBucket(array_bucket_[begin_ / size_bucket_]);
+                array_bucket_[begin_ / size_bucket_] = nullptr;
             }
             ++begin_;
             throw;
         }
+        return *Pointer(begin_);
     }
 
 private:
@@ -166,13 +286,13 @@ private:
         common_iterator() = default;
 
         common_iterator(const common_iterator<IsConst> &other)
-                : begin_array_(other.begin_array_), index_(other.index_), size_bucket_(other.size_bucket_) {}
+                : begin_array_(other.begin_array_), index_(other.index_) {}
 
 
         common_iterator<IsConst> &operator=(common_iterator<IsConst> other) {
             begin_array_ = other.begin_array_;
             index_ = other.index_;
-            size_bucket_ = other.size_bucket_;
+            return *this;
         }
 
         common_iterator<IsConst> &operator++() {
@@ -245,16 +365,16 @@ private:
             return !operator==(other);
         }
 
-        T_ &operator*() {
+        T_ &operator*() const {
             return *(*(begin_array_ + index_ / size_bucket_) + index_ % size_bucket_);
         }
 
-        T_ *operator->() {
+        T_ *operator->() const {
             return (*(begin_array_ + index_ / size_bucket_) + index_ % size_bucket_);
         }
 
         operator common_iterator<true>() const {
-            return common_iterator<true>(begin_array_, index_, size_bucket_);
+            return common_iterator<true>(begin_array_, index_);
         }
 
 
@@ -267,16 +387,15 @@ private:
 
     private:
         friend common_iterator<false>;
-        friend Deque<T>;
+        friend Deque;
 
         common_iterator(
                 std::conditional_t<IsConst, typename std::vector<T *>::const_iterator, typename std::vector<T *>::iterator> begin_array,
-                size_t index, size_t size_bucket)
-                : begin_array_(begin_array), index_(index), size_bucket_(size_bucket) {}
+                size_t index)
+                : begin_array_(begin_array), index_(index) {}
 
         std::conditional_t<IsConst, typename std::vector<T *>::const_iterator, typename std::vector<T *>::iterator> begin_array_;
         size_t index_;
-        const size_t size_bucket_ = 16;
 
     };
 
@@ -287,27 +406,27 @@ public:
     using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
     iterator begin() {
-        return iterator(array_bucket_.begin(), begin_, size_bucket_);
+        return iterator(array_bucket_.begin(), begin_);
     }
 
     const_iterator begin() const {
-        return const_iterator(array_bucket_.begin(), begin_, size_bucket_);
+        return const_iterator(array_bucket_.begin(), begin_);
     }
 
     iterator end() {
-        return iterator(array_bucket_.begin(), end_, size_bucket_);
+        return iterator(array_bucket_.begin(), end_);
     }
 
     const_iterator end() const {
-        return const_iterator(array_bucket_.begin(), end_, size_bucket_);
+        return const_iterator(array_bucket_.begin(), end_);
     }
 
     const_iterator cbegin() const {
-        return const_iterator(array_bucket_.begin(), begin_, size_bucket_);
+        return const_iterator(array_bucket_.begin(), begin_);
     }
 
     const_iterator cend() const {
-        return const_iterator(array_bucket_.begin(), end_, size_bucket_);
+        return const_iterator(array_bucket_.begin(), end_);
     }
 
     reverse_iterator rbegin() {
@@ -334,40 +453,158 @@ public:
         return std::reverse_iterator<const_iterator>(cbegin());
     }
 
+private:
+    // A run of elements that are contiguous in memory: a whole block, or the part of one at
+    // either end of the range.
+    template<bool IsConst>
+    struct common_segment {
+        using T_ = std::conditional_t<IsConst, const T, T>;
 
-    void insert(iterator iter, const T &item) {
-        Deque<T> copy_deque;
-        copy_deque.size_bucket_ = size_bucket_;
-        copy_deque.begin_ = begin_;
-        copy_deque.end_ = begin_;
-        copy_deque.array_bucket_.resize((begin_ + size_bucket_ - 1) / size_bucket_, nullptr);
+        T_ *data;
+        size_t size;
 
-        copy_deque.MemoryAllocation();
-        for (size_t i = begin_; i < iter.index_; ++i) {
-            copy_deque.push_back(*Pointer(i));
+        T_ *begin() const {
+            return data;
         }
-        copy_deque.push_back(item);
-        for (size_t i = iter.index_; i < end_; ++i) {
-            copy_deque.push_back(*Pointer(i));
+
+        T_ *end() const {
+            return data + size;
         }
-        Swap(copy_deque);
-    }
+    };
+
+    // The segments covering a range of the deque, one per block it touches, in order.
+    template<bool IsConst>
+    class common_segment_range {
+        using BucketIterator = std::conditional_t<IsConst, typename std::vector<T *>::const_iterator,
+                typename std::vector<T *>::iterator>;
+
+    public:
+        class iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = common_segment<IsConst>;
+            using difference_type = ptrdiff_t;
+            using pointer = const value_type *;
+            using reference = value_type;
+
+            common_segment<IsConst> operator*() const {
+                return {*(begin_array_ + index_ / size_bucket_) + index_ % size_bucket_, Next() - index_};
+            }
+
+            iterator &operator++() {
+                index_ = Next();
+                return *this;
+            }
+
+            iterator operator++(int) {
+                iterator copy_iterator(*this);
+                index_ = Next();
+                return copy_iterator;
+            }
+
+            bool operator==(const iterator &other) const {
+                return index_ == other.index_;
+            }
+
+            bool operator!=(const iterator &other) const {
+                return index_ != other.index_;
+            }
 
-    void erase(iterator iter) {
-        Deque<T> copy_deque;
-        copy_deque.size_bucket_ = size_bucket_;
-        copy_deque.begin_ = begin_;
-        copy_deque.end_ = begin_;
-        copy_deque.array_bucket_.resize((begin_ + size_bucket_ - 1) / size_bucket_, nullptr);
+            // The deque iterator at the first element of this segment.
+            common_iterator<IsConst> position() const {
+                return common_iterator<IsConst>(begin_array_, index_);
+            }
 
-        copy_deque.MemoryAllocation();
-        for (size_t i = begin_; i < iter.index_; ++i) {
-            copy_deque.push_back(*Pointer(i));
+        private:
+            friend common_segment_range;
+
+            iterator(BucketIterator begin_array, size_t index, size_t last)
+                    : begin_array_(begin_array), index_(index), last_(last) {}
+
+            size_t Next() const {
+                return std::min((index_ / size_bucket_ + 1) * size_bucket_, last_);
+            }
+
+            BucketIterator begin_array_;
+            size_t index_;
+            size_t last_;
+        };
+
+        iterator begin() const {
+            return iterator(begin_array_, first_, last_);
         }
-        for (size_t i = iter.index_ + 1; i < end_; ++i) {
-            copy_deque.push_back(*Pointer(i));
+
+        iterator end() const {
+            return iterator(begin_array_, last_, last_);
         }
-        Swap(copy_deque);
+
+    private:
+        friend Deque;
+
+        common_segment_range(BucketIterator begin_array, size_t first, size_t last)
+                : begin_array_(begin_array), first_(first), last_(last) {}
+
+        BucketIterator begin_array_;
+        size_t first_;
+        size_t last_;
+    };
+
+public:
+    using segment = common_segment<false>;
+    using const_segment = common_segment<true>;
+    using segment_range = common_segment_range<false>;
+    using const_segment_range = common_segment_range<true>;
+
+    // The deque, or [first, last) of it, as contiguous runs of elements, so that loops over it
+    // can run over plain pointers; see the segmented:: algorithms below.
+    segment_range segments() {
+        return segment_range(array_bucket_.begin(), begin_, end_);
+    }
+
+    const_segment_range segments() const {
+        return const_segment_range(array_bucket_.begin(), begin_, end_);
+    }
+
+    segment_range segments(iterator first, iterator last) {
+        return segment_range(array_bucket_.begin(), first.index_, last.index_);
+    }
+
+    const_segment_range segments(const_iterator first, const_iterator last) const {
+        return const_segment_range(array_bucket_.begin(), first.index_, last.index_);
+    }
+
+
+    iterator insert(const_iterator iter, const T &item) {
+        T value(item);
+        return InsertRange(iter.index_ - begin_, 1, std::make_move_iterator(&value));
+    }
+
+    iterator insert(const_iterator iter, T &&item) {
+        return emplace(iter, std::move(item));
+    }
+
+    template<typename... Args>
+    iterator emplace(const_iterator iter, Args &&... args) {
+        T value(std::forward<Args>(args)...);
+        return InsertRange(iter.index_ - begin_, 1, std::make_move_iterator(&value));
+    }
+
+    iterator insert(const_iterator iter, size_t count, const T &item) {
+        T value(item);
+        return InsertRange(iter.index_ - begin_, count, RepeatIterator{&value, 0});
+    }
+
+    template<typename ForwardIt, typename = std::enable_if_t<!std::is_integral<ForwardIt>::value>>
+    iterator insert(const_iterator iter, ForwardIt first, ForwardIt last) {
+        return InsertRange(iter.index_ - begin_, std::distance(first, last), first);
+    }
+
+    iterator erase(const_iterator iter) {
+        return EraseRange(iter.index_ - begin_, 1);
+    }
+
+    iterator erase(const_iterator first, const_iterator last) {
+        return EraseRange(first.index_ - begin_, last.index_ - first.index_);
     }
 
 private:
@@ -375,7 +612,11 @@ private:
     std::vector<T *> array_bucket_;
     size_t begin_ = 0;
     size_t end_ = 0;
-    size_t size_bucket_ = 12;
+    static constexpr size_t size_bucket_ = SizeBucket;
+    static constexpr size_t default_spare_limit_ = 2;
+
+    std::vector<T *> spare_buckets_;
+    size_t spare_limit_ = default_spare_limit_;
 
     void RangeCheck(int64_t index) const {
         index += begin_;
@@ -384,14 +625,312 @@ private:
         }
     }
 
-    void Resize() {
-        std::vector<T *> new_array_bucket_(array_bucket_.size() * 2 + 2, nullptr);
-        for (size_t i = 0; i < array_bucket_.size(); ++i) {
-            new_array_bucket_[i + array_bucket_.size() + 2] = array_bucket_[i];
+    // The block map is a fixed run of slots with the used blocks somewhere in the middle. When
+    // an end runs out of slots the used blocks are recentred: in place if they take at most half
+    // of the map, otherwise in a map twice the size they need. Either way the next recentring is
+    // at least a quarter of the map away, so pushes stay amortized O(1) and a queue moving
+    // through the deque keeps a map proportional to its length.
+    void ReserveMap(size_t front, size_t back) {
+        if (begin_ >= front && end_ + back <= array_bucket_.size() * size_bucket_) {
+            return;
+        }
+        size_t used = (end_ + size_bucket_ - 1) / size_bucket_ - begin_ / size_bucket_;
+        size_t front_slots = (front + size_bucket_ - 1) / size_bucket_;
+        size_t needed = used + front_slots + (back + size_bucket_ - 1) / size_bucket_;
+        size_t map_size = array_bucket_.size();
+        if (2 * needed > map_size) {
+            map_size = std::max<size_t>(2 * needed, 8);
+        }
+        Remap(map_size, (map_size - needed) / 2 + front_slots);
+    }
+
+    // Moves the used blocks to slot `first` of a map of `map_size` slots.
+    void Remap(size_t map_size, size_t first) {
+        size_t old_first = begin_ / size_bucket_;
+        size_t used = (end_ + size_bucket_ - 1) / size_bucket_ - old_first;
+        auto old_begin = array_bucket_.begin() + old_first;
+        if (map_size != array_bucket_.size()) {
+            std::vector<T *> new_array_bucket(map_size, nullptr);
+            std::copy(old_begin, old_begin + used, new_array_bucket.begin() + first);
+            array_bucket_.swap(new_array_bucket);
+        } else if (first < old_first) {
+            std::copy(old_begin, old_begin + used, array_bucket_.begin() + first);
+        } else {
+            std::copy_backward(old_begin, old_begin + used, array_bucket_.begin() + first + used);
+        }
+        std::fill(array_bucket_.begin(), array_bucket_.begin() + first, nullptr);
+        std::fill(array_bucket_.begin() + first + used, array_bucket_.end(), nullptr);
+        size_t count = end_ - begin_;
+        begin_ = begin_ % size_bucket_ + first * size_bucket_;
+        end_ = begin_ + count;
+    }
+
+    struct RepeatIterator {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = ptrdiff_t;
+        using pointer = const T *;
+        using reference = const T &;
+
+        const T *value;
+        size_t index;
+
+        const T &operator*() const {
+            return *value;
+        }
+
+        RepeatIterator &operator++() {
+            ++index;
+            return *this;
+        }
+
+        bool operator==(const RepeatIterator &other) const {
+            return index == other.index;
+        }
+
+        bool operator!=(const RepeatIterator &other) const {
+            return index != other.index;
+        }
+    };
+
+    // Opens `count` slots at position `pos` by shifting the shorter side: the elements that move
+    // past the old ends are relocated into fresh slots (moved if that cannot throw, copied
+    // otherwise, so a failure leaves them intact), the rest are move-assigned in place.
+    // Strong guarantee while only fresh slots are being constructed (an insertion at either end),
+    // basic guarantee once assignments over existing elements have started.
+    template<typename ForwardIt>
+    iterator InsertRange(size_t pos, size_t count, ForwardIt first) {
+        if (count == 0) {
+            return iterator(array_bucket_.begin(), begin_ + pos);
+        }
+        size_t count_after = size() - pos;
+        if (pos < count_after) {
+            ReserveFront(count);
+            size_t from = begin_ - count;
+            size_t id = from;
+            try {
+                for (size_t i = 0; i < std::min(count, pos); ++i, ++id) {
+                    new(Pointer(id)) T(std::move_if_noexcept(*Pointer(begin_ + i)));
+                }
+                for (; id < begin_; ++id, ++first) {
+                    new(Pointer(id)) T(*first);
+                }
+            } catch (...) {
+                for (size_t i = from; i < id; ++i) {
+                    Pointer(i)->~T();
+                }
+                TrimFront(from);
+                throw;
+            }
+            begin_ = from;
+            if (pos > count) {
+                MoveDown(begin_ + 2 * count, begin_ + count, pos - count);
+            }
+            for (size_t i = std::max(count, pos); i < pos + count; ++i, ++first) {
+                *Pointer(begin_ + i) = *first;
+            }
+        } else {
+            ReserveBack(count);
+            size_t id = end_;
+            try {
+                ForwardIt value = std::next(first, std::min(count, count_after));
+                for (size_t i = count_after; i < count; ++i, ++id, ++value) {
+                    new(Pointer(id)) T(*value);
+                }
+                for (size_t i = end_ - std::min(count, count_after); i < end_; ++i, ++id) {
+                    new(Pointer(id)) T(std::move_if_noexcept(*Pointer(i)));
+                }
+            } catch (...) {
+                for (size_t i = end_; i < id; ++i) {
+                    Pointer(i)->~T();
+                }
+                TrimBack();
+                throw;
+            }
+            if (count < count_after) {
+                MoveUp(begin_ + pos, begin_ + pos + count, count_after - count);
+            }
+            end_ += count;
+            for (size_t i = 0; i < std::min(count, count_after); ++i, ++first) {
+                *Pointer(begin_ + pos + i) = *first;
+            }
+        }
+        return iterator(array_bucket_.begin(), begin_ + pos);
+    }
+
+    iterator EraseRange(size_t pos, size_t count) {
+        if (count == 0) {
+            return iterator(array_bucket_.begin(), begin_ + pos);
+        }
+        if (pos < size() - pos - count) {
+            MoveUp(begin_, begin_ + count, pos);
+            for (size_t i = 0; i < count; ++i) {
+                pop_front();
+            }
+        } else {
+            MoveDown(begin_ + pos + count, begin_ + pos, end_ - begin_ - pos - count);
+            for (size_t i = 0; i < count; ++i) {
+                pop_back();
+            }
+        }
+        return iterator(array_bucket_.begin(), begin_ + pos);
+    }
+
+    // Move-assigns [from, from + count) to [to, to + count) for to < from, one contiguous run
+    // at a time.
+    void MoveDown(size_t from, size_t to, size_t count) {
+        while (count > 0) {
+            size_t chunk = std::min({count, size_bucket_ - from % size_bucket_, size_bucket_ - to % size_bucket_});
+            std::move(Pointer(from), Pointer(from) + chunk, Pointer(to));
+            from += chunk;
+            to += chunk;
+            count -= chunk;
+        }
+    }
+
+    // The same for to > from, from the last element down.
+    void MoveUp(size_t from, size_t to, size_t count) {
+        while (count > 0) {
+            size_t chunk = std::min({count, (from + count - 1) % size_bucket_ + 1, (to + count - 1) % size_bucket_ + 1});
+            T *source_end = Pointer(from + count - 1) + 1;
+            std::move_backward(source_end - chunk, source_end, Pointer(to + count - 1) + 1);
+            count -= chunk;
+        }
+    }
+
+    // Constructs `count` elements past end_, one block-sized run at a time: construct(out, run)
+    // builds `run` elements at `out` and destroys them again if it throws.
+    template<typename Construct>
+    void AppendBlocks(size_t count, Construct construct) {
+        ReserveBack(count);
+        size_t id = end_;
+        try {
+            while (id < end_ + count) {
+                size_t run = std::min(end_ + count - id, size_bucket_ - id % size_bucket_);
+                construct(Pointer(id), run);
+                id += run;
+            }
+        } catch (...) {
+            for (size_t i = end_; i < id; ++i) {
+                Pointer(i)->~T();
+            }
+            TrimBack();
+            throw;
+        }
+        end_ += count;
+    }
+
+    template<typename ForwardIt>
+    static ForwardIt CopyRun(T *out, ForwardIt first, size_t count) {
+        if constexpr (std::is_trivially_copyable<T>::value && deque_detail::IsContiguous<ForwardIt, T>::value) {
+            std::memcpy(out, std::addressof(*first), count * sizeof(T));
+            return first + count;
+        } else {
+            size_t i = 0;
+            try {
+                for (; i < count; ++i, ++first) {
+                    new(out + i) T(*first);
+                }
+            } catch (...) {
+                std::destroy(out, out + i);
+                throw;
+            }
+            return first;
+        }
+    }
+
+    static void FillRun(T *out, size_t count, const T &item) {
+        if constexpr (std::is_trivially_copyable<T>::value) {
+            unsigned char bytes[sizeof(T)];
+            std::memcpy(bytes, std::addressof(item), sizeof(T));
+            if (std::all_of(bytes, bytes + sizeof(T), [&bytes](unsigned char byte) { return byte == bytes[0]; })) {
+                std::memset(out, bytes[0], count * sizeof(T));
+                return;
+            }
+        }
+        std::uninitialized_fill_n(out, count, item);
+    }
+
+    // Allocates the blocks of [begin_ - count, begin_) without constructing anything in them.
+    void ReserveFront(size_t count) {
+        ReserveMap(count, 0);
+        try {
+            for (size_t i = (begin_ - count) / size_bucket_; i * size_bucket_ < begin_; ++i) {
+                if (array_bucket_[i] == nullptr) {
+                    array_bucket_[i] = AllocateBucket();
+                }
+            }
+        } catch (...) {
+            TrimFront(begin_ - count);
+            throw;
+        }
+    }
+
+    // Frees the blocks below begin_ from the one holding `from` on.
+    void TrimFront(size_t from) {
+        for (size_t i = from / size_bucket_; (i + 1) * size_bucket_ <= begin_; ++i) {
+            FreeBucket(array_bucket_[i]);
+            array_bucket_[i] = nullptr;
+        }
+    }
+
+    // Allocates the blocks of [end_, end_ + count) without constructing anything in them.
+    void ReserveBack(size_t count) {
+        ReserveMap(0, count);
+        try {
+            for (size_t i = end_ / size_bucket_; i * size_bucket_ < end_ + count; ++i) {
+                if (array_bucket_[i] == nullptr) {
+                    array_bucket_[i] = AllocateBucket();
+                }
+            }
+        } catch (...) {
+            TrimBack();
+            throw;
+        }
+    }
+
+    // Frees the blocks past the one holding end_ - 1.
+    void TrimBack() {
+        for (size_t i = (end_ + size_bucket_ - 1) / size_bucket_;
+             i < array_bucket_.size() && array_bucket_[i] != nullptr; ++i) {
+            FreeBucket(array_bucket_[i]);
+            array_bucket_[i] = nullptr;
         }
-        begin_ += (array_bucket_.size() + 2) * size_bucket_;
-        end_ += (array_bucket_.size() + 2) * size_bucket_;
-        array_bucket_ = new_array_bucket_;
+    }
+
+    static T *NewBucket() {
+        return reinterpret_cast<T *>(new int8_t[size_bucket_ * sizeof(T)]);
+    }
+
+    static void DeleteBucket(T *bucket) {
+        delete[] reinterpret_cast<int8_t *>(bucket);
+    }
+
+    // The spare list has room for spare_limit_ blocks once the first block is allocated, so
+    // FreeBucket never allocates and stays usable from pops and rollbacks.
+    T *AllocateBucket() {
+        if (!spare_buckets_.empty()) {
+            T *bucket = spare_buckets_.back();
+            spare_buckets_.pop_back();
+            return bucket;
+        }
+        spare_buckets_.reserve(spare_limit_);
+        return NewBucket();
+    }
+
+    void FreeBucket(T *bucket) {
+        if (spare_buckets_.size() < spare_limit_) {
+            spare_buckets_.push_back(bucket);
+        } else {
+            DeleteBucket(bucket);
+        }
+    }
+
+    void ReleaseSpareBuckets() {
+        for (T *bucket : spare_buckets_) {
+            DeleteBucket(bucket);
+        }
+        spare_buckets_.clear();
     }
 
     T *Pointer(size_t index) const {
@@ -400,22 +939,88 @@ private:
 
     void MemoryAllocation() {
         for (size_t i = begin_ / size_bucket_; i * size_bucket_ < end_; ++i) {
-            array_bucket_[i] = reinterpret_cast <T *> (new int8_t[size_bucket_ * sizeof(T)]);
+            array_bucket_[i] = AllocateBucket();
         }
     }
 
     void MemoryDelete() {
         for (size_t i = begin_ / size_bucket_; i * size_bucket_ < end_; ++i) {
-            delete[] reinterpret_cast<int8_t *> (array_bucket_[i]);
+            DeleteBucket(array_bucket_[i]);
         }
     }
 
-    void Swap(Deque<T> &other) {
+    void Swap(Deque &other) {
         std::swap(array_bucket_, other.array_bucket_);
         std::swap(begin_, other.begin_);
         std::swap(end_, other.end_);
-        std::swap(size_bucket_, other.size_bucket_);
+        std::swap(spare_buckets_, other.spare_buckets_);
+        std::swap(spare_limit_, other.spare_limit_);
     }
 
 
 };
+
+// Algorithms over a segment range of a Deque (deque.segments() or deque.segments(first, last)),
+// running a plain pointer loop per block instead of going through the element iterator.
+namespace segmented {
+
+template<typename Segments, typename Function>
+Function for_each(const Segments &segments, Function function) {
+    for (auto segment : segments) {
+        for (auto *item = segment.begin(); item != segment.end(); ++item) {
+            function(*item);
+        }
+    }
+    return function;
+}
+
+template<typename Segments, typename OutputIt>
+OutputIt copy(const Segments &segments, OutputIt out) {
+    for (auto segment : segments) {
+        out = std::copy(segment.begin(), segment.end(), out);
+    }
+    return out;
+}
+
+template<typename Segments, typename Value>
+void fill(const Segments &segments, const Value &value) {
+    for (auto segment : segments) {
+        std::fill(segment.begin(), segment.end(), value);
+    }
+}
+
+// The deque iterator at the first element equal to `value`, or at the end of the range.
+template<typename Segments, typename Value>
+auto find(const Segments &segments, const Value &value) {
+    auto it = segments.begin();
+    for (; it != segments.end(); ++it) {
+        auto segment = *it;
+        auto *found = std::find(segment.begin(), segment.end(), value);
+        if (found != segment.end()) {
+            return it.position() + (found - segment.begin());
+        }
+    }
+    return it.position();
+}
+
+template<typename Segments, typename Value>
+Value accumulate(const Segments &segments, Value init) {
+    for (auto segment : segments) {
+        for (auto *item = segment.begin(); item != segment.end(); ++item) {
+            init = std::move(init) + *item;
+        }
+    }
+    return init;
+}
+
+template<typename Segments, typename Value, typename Operation>
+Value accumulate(const Segments &segments, Value init, Operation operation) {
+    for (auto segment : segments) {
+        for (auto *item = segment.begin(); item != segment.end(); ++item) {
+            init = operation(std::move(init), *item);
+        }
+    }
+    return init;
+}
+
+}  // namespace segmented
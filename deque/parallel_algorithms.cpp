@@ -0,0 +1,247 @@
+#pragma once
+
+#include "deque.cpp"
+#include "thread_pool.cpp"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace parallel_detail {
+
+inline unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+inline size_t serial_threshold = size_t(1) << 15;
+inline std::unique_ptr<ThreadPool> pool;
+
+inline ThreadPool &Pool() {
+    if (!pool || pool->size() != threads) {
+        pool.reset();
+        pool = std::make_unique<ThreadPool>(threads);
+    }
+    return *pool;
+}
+
+inline bool Serial(size_t size) {
+    return threads <= 1 || size < serial_threshold;
+}
+
+// Offsets 0 = cuts[0] < cuts[1] < ... < cuts.back() = size splitting the deque into at most
+// `pieces` runs of whole blocks (the first and last may be partial), so that no two pieces
+// share a block.
+template<typename T, size_t SizeBucket>
+std::vector<size_t> BlockCuts(const Deque<T, SizeBucket> &deque, size_t pieces) {
+    size_t size = deque.size();
+    std::vector<size_t> cuts = {0};
+    if (size == 0) {
+        return cuts;
+    }
+    size_t head = (*deque.segments().begin()).size;
+    size_t blocks = 1 + (size - head + SizeBucket - 1) / SizeBucket;
+    size_t blocks_per_piece = (blocks + pieces - 1) / pieces;
+    for (size_t block = blocks_per_piece; block < blocks; block += blocks_per_piece) {
+        cuts.push_back(head + (block - 1) * SizeBucket);
+    }
+    cuts.push_back(size);
+    return cuts;
+}
+
+// Calls body(first, last) for every piece [cuts[i], cuts[i + 1]) on the pool.
+template<typename Body>
+void ForEachPiece(const std::vector<size_t> &cuts, const Body &body) {
+    Pool().parallel_for(0, cuts.size() - 1, 1, [&cuts, &body](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            body(cuts[i], cuts[i + 1]);
+        }
+    });
+}
+
+// Merges the sorted runs [a, a_last) and [b, b_last) into `out`, stably, splitting the larger
+// run in half and the other at the matching point until a piece is below `grain`. A split that
+// leaves the first piece empty would hand the whole merge on unchanged, so that piece is merged
+// serially instead; with a grain of at least 2 it does not happen.
+template<typename InputIt1, typename InputIt2, typename OutputIt, typename Compare>
+void Merge(WaitGroup &group, InputIt1 a, InputIt1 a_last, InputIt2 b, InputIt2 b_last, OutputIt out,
+           Compare comp, size_t grain) {
+    while (size_t(a_last - a) + size_t(b_last - b) > grain) {
+        InputIt1 a_middle;
+        InputIt2 b_middle;
+        if (a_last - a >= b_last - b) {
+            a_middle = a + (a_last - a) / 2;
+            b_middle = std::lower_bound(b, b_last, *a_middle, comp);
+        } else {
+            b_middle = b + (b_last - b) / 2;
+            a_middle = std::upper_bound(a, a_last, *b_middle, comp);
+        }
+        if (a_middle == a && b_middle == b) {
+            break;
+        }
+        OutputIt out_middle = out + ((a_middle - a) + (b_middle - b));
+        Pool().submit(group, [&group, a_middle, a_last, b_middle, b_last, out_middle, comp, grain] {
+            Merge(group, a_middle, a_last, b_middle, b_last, out_middle, comp, grain);
+        });
+        a_last = a_middle;
+        b_last = b_middle;
+    }
+    std::merge(std::make_move_iterator(a), std::make_move_iterator(a_last), std::make_move_iterator(b),
+               std::make_move_iterator(b_last), out, comp);
+}
+
+// Merges neighbouring pairs of the sorted runs between `cuts` from `source` into `destination`
+// and returns the cuts of the merged runs.
+template<typename SourceIt, typename DestinationIt, typename Compare>
+std::vector<size_t> MergeRound(SourceIt source, DestinationIt destination, const std::vector<size_t> &cuts,
+                               Compare comp) {
+    size_t grain = std::max<size_t>({serial_threshold, cuts.back() / (4 * threads), 2});
+    std::vector<size_t> merged = {0};
+    WaitGroup group;
+    for (size_t i = 0; i + 1 < cuts.size(); i += 2) {
+        size_t first = cuts[i];
+        size_t middle = cuts[i + 1];
+        size_t last = i + 2 < cuts.size() ? cuts[i + 2] : middle;
+        Pool().submit(group, [&group, source, destination, first, middle, last, comp, grain] {
+            Merge(group, source + first, source + middle, source + middle, source + last, destination + first,
+                  comp, grain);
+        });
+        merged.push_back(last);
+    }
+    Pool().wait(group);
+    return merged;
+}
+
+// Sorts every piece with `sort_piece`, then merges the pieces pairwise, going back and forth
+// between the deque and a buffer (so T has to be default constructible).
+template<typename T, size_t SizeBucket, typename Compare, typename SortPiece>
+void Sort(Deque<T, SizeBucket> &deque, Compare comp, SortPiece sort_piece) {
+    std::vector<size_t> cuts = BlockCuts(deque, threads);
+    ForEachPiece(cuts, [&deque, &sort_piece](size_t first, size_t last) {
+        sort_piece(deque.begin() + first, deque.begin() + last);
+    });
+    if (cuts.size() <= 2) {
+        return;
+    }
+    std::vector<T> buffer(deque.size());
+    bool in_buffer = false;
+    while (cuts.size() > 2) {
+        if (in_buffer) {
+            cuts = MergeRound(buffer.begin(), deque.begin(), cuts, comp);
+        } else {
+            cuts = MergeRound(deque.begin(), buffer.begin(), cuts, comp);
+        }
+        in_buffer = !in_buffer;
+    }
+    if (in_buffer) {
+        ForEachPiece(BlockCuts(deque, 4 * threads), [&deque, &buffer](size_t first, size_t last) {
+            std::move(buffer.begin() + first, buffer.begin() + last, deque.begin() + first);
+        });
+    }
+}
+
+}  // namespace parallel_detail
+
+// Algorithms over a whole Deque on a shared ThreadPool. The work is cut on block boundaries, so
+// each thread writes its own blocks and no two share a cache line through a common block.
+// Below the serial threshold, or with a single thread, they run on the calling thread.
+namespace parallel {
+
+// Sets the pool size and the size under which the algorithms stay serial. Not to be called
+// while one of them is running.
+inline void set_parallelism(unsigned threads, size_t serial_threshold = size_t(1) << 15) {
+    parallel_detail::threads = std::max(threads, 1u);
+    parallel_detail::serial_threshold = serial_threshold;
+}
+
+inline unsigned parallelism() {
+    return parallel_detail::threads;
+}
+
+template<typename T, size_t SizeBucket, typename Function>
+void for_each(Deque<T, SizeBucket> &deque, Function function) {
+    if (parallel_detail::Serial(deque.size())) {
+        segmented::for_each(deque.segments(), function);
+        return;
+    }
+    std::vector<size_t> cuts = parallel_detail::BlockCuts(deque, 4 * parallel_detail::threads);
+    parallel_detail::ForEachPiece(cuts, [&deque, &function](size_t first, size_t last) {
+        segmented::for_each(deque.segments(deque.begin() + first, deque.begin() + last), function);
+    });
+}
+
+// destination[i] = operation(source[i]) for every i; the two deques must be of the same size.
+template<typename T, size_t SizeBucket, typename U, size_t OtherSizeBucket, typename Operation>
+void transform(const Deque<T, SizeBucket> &source, Deque<U, OtherSizeBucket> &destination, Operation operation) {
+    if (source.size() != destination.size()) {
+        throw std::invalid_argument("parallel::transform: deques of different sizes");
+    }
+    auto transform_piece = [&source, &destination, &operation](size_t first, size_t last) {
+        auto out = destination.begin() + first;
+        for (auto segment : source.segments(source.begin() + first, source.begin() + last)) {
+            for (auto target : destination.segments(out, out + segment.size)) {
+                std::transform(segment.data, segment.data + target.size, target.data, operation);
+                segment.data += target.size;
+            }
+            out += segment.size;
+        }
+    };
+    if (parallel_detail::Serial(source.size())) {
+        transform_piece(0, source.size());
+        return;
+    }
+    std::vector<size_t> cuts = parallel_detail::BlockCuts(source, 4 * parallel_detail::threads);
+    parallel_detail::ForEachPiece(cuts, transform_piece);
+}
+
+// Folds the elements into `init` with `operation`, which has to be associative: pieces are
+// folded separately and their results combined in order.
+template<typename T, size_t SizeBucket, typename Value, typename Operation = std::plus<>>
+Value reduce(const Deque<T, SizeBucket> &deque, Value init, Operation operation = Operation()) {
+    if (parallel_detail::Serial(deque.size())) {
+        return segmented::accumulate(deque.segments(), std::move(init), operation);
+    }
+    std::vector<size_t> cuts = parallel_detail::BlockCuts(deque, 4 * parallel_detail::threads);
+    std::vector<std::unique_ptr<Value>> partial(cuts.size() - 1);
+    parallel_detail::Pool().parallel_for(0, partial.size(), 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            Value value(deque[cuts[i]]);
+            value = segmented::accumulate(deque.segments(deque.begin() + cuts[i] + 1, deque.begin() + cuts[i + 1]),
+                                          std::move(value), operation);
+            partial[i] = std::make_unique<Value>(std::move(value));
+        }
+    });
+    for (auto &value : partial) {
+        init = operation(std::move(init), std::move(*value));
+    }
+    return init;
+}
+
+template<typename T, size_t SizeBucket, typename Compare = std::less<>>
+void sort(Deque<T, SizeBucket> &deque, Compare comp = Compare()) {
+    using Iterator = typename Deque<T, SizeBucket>::iterator;
+    auto sort_piece = [&comp](Iterator first, Iterator last) {
+        std::sort(first, last, comp);
+    };
+    if (parallel_detail::Serial(deque.size())) {
+        sort_piece(deque.begin(), deque.end());
+        return;
+    }
+    parallel_detail::Sort(deque, comp, sort_piece);
+}
+
+template<typename T, size_t SizeBucket, typename Compare = std::less<>>
+void stable_sort(Deque<T, SizeBucket> &deque, Compare comp = Compare()) {
+    using Iterator = typename Deque<T, SizeBucket>::iterator;
+    auto sort_piece = [&comp](Iterator first, Iterator last) {
+        std::stable_sort(first, last, comp);
+    };
+    if (parallel_detail::Serial(deque.size())) {
+        sort_piece(deque.begin(), deque.end());
+        return;
+    }
+    parallel_detail::Sort(deque, comp, sort_piece);
+}
+
+}  // namespace parallel
@@ -0,0 +1,220 @@
+#pragma once
+
+#include "deque.cpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+// A lock-free queue for exactly one producer thread and one consumer thread, laid out like
+// Deque: elements live in blocks of SizeBucket slots, but the blocks form a linked list. The
+// producer owns the tail block, the consumer the head block, and each side publishes its index
+// on its own cache line. Blocks the consumer has left go back to the producer for reuse, so a
+// queue in steady state does not allocate.
+//
+// The queue is unbounded unless given a capacity; try_push fails only when the capacity is reached.
+template<typename T, size_t SizeBucket = deque_detail::DefaultSizeBucket(sizeof(T))>
+class SpscQueue {
+    static_assert(SizeBucket > 0 && (SizeBucket & (SizeBucket - 1)) == 0, "the block size must be a power of two");
+
+public:
+    explicit SpscQueue(size_t capacity = std::numeric_limits<size_t>::max()) : capacity_(capacity) {
+        Bucket *bucket = new Bucket;
+        tail_bucket_ = first_bucket_ = head_bucket_ = bucket;
+        consumer_bucket_.store(bucket, std::memory_order_relaxed);
+    }
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    ~SpscQueue() {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        for (size_t i = head_.load(std::memory_order_relaxed); i < tail; ++i) {
+            BucketForPop(i)->Slot(i)->~T();
+        }
+        while (first_bucket_ != nullptr) {
+            Bucket *next = first_bucket_->next;
+            delete first_bucket_;
+            first_bucket_ = next;
+        }
+        delete spare_bucket_;
+    }
+
+    // Producer side.
+
+    bool try_push(const T &item) {
+        return try_emplace(item);
+    }
+
+    bool try_push(T &&item) {
+        return try_emplace(std::move(item));
+    }
+
+    template<typename... Args>
+    bool try_emplace(Args &&... args) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (Room(tail, 1) == 0) {
+            return false;
+        }
+        Bucket *bucket = BucketForPush(tail);
+        new(bucket->Slot(tail)) T(std::forward<Args>(args)...);
+        LinkBucket(bucket);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Pushes up to `count` elements from `first` with a single publication and returns how many
+    // went in. If constructing one throws, the ones before it stay pushed.
+    template<typename InputIt>
+    size_t try_push_bulk(InputIt first, size_t count) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        count = std::min(count, Room(tail, count));
+        size_t pushed = 0;
+        try {
+            for (; pushed < count; ++pushed, ++first) {
+                Bucket *bucket = BucketForPush(tail + pushed);
+                new(bucket->Slot(tail + pushed)) T(*first);
+                LinkBucket(bucket);
+            }
+        } catch (...) {
+            tail_.store(tail + pushed, std::memory_order_release);
+            throw;
+        }
+        tail_.store(tail + pushed, std::memory_order_release);
+        return pushed;
+    }
+
+    // Consumer side.
+
+    bool try_pop(T &item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (Available(head, 1) == 0) {
+            return false;
+        }
+        T *slot = BucketForPop(head)->Slot(head);
+        item = std::move(*slot);
+        slot->~T();
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Pops up to `max_count` elements into `out` with a single publication and returns how many
+    // came out. If assigning one throws, it and the ones after it stay in the queue.
+    template<typename OutputIt>
+    size_t try_pop_bulk(OutputIt out, size_t max_count) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t count = Available(head, max_count);
+        size_t popped = 0;
+        try {
+            for (; popped < count; ++popped) {
+                T *slot = BucketForPop(head + popped)->Slot(head + popped);
+                *out = std::move(*slot);
+                ++out;
+                slot->~T();
+            }
+        } catch (...) {
+            head_.store(head + popped, std::memory_order_release);
+            throw;
+        }
+        head_.store(head + popped, std::memory_order_release);
+        return popped;
+    }
+
+    // Exact only while neither side is running; otherwise a snapshot that may already be stale.
+    size_t size() const {
+        size_t head = head_.load(std::memory_order_acquire);
+        return tail_.load(std::memory_order_acquire) - head;
+    }
+
+    size_t capacity() const {
+        return capacity_;
+    }
+
+private:
+    static constexpr size_t size_bucket_ = SizeBucket;
+    static constexpr size_t cache_line_ = 64;
+
+    struct Bucket {
+        alignas(T) int8_t storage[size_bucket_ * sizeof(T)];
+        Bucket *next = nullptr;
+
+        T *Slot(size_t index) {
+            return reinterpret_cast<T *>(storage) + index % size_bucket_;
+        }
+    };
+
+    const size_t capacity_;
+
+    // Producer: the published end, the block being filled and the index where it ends, the
+    // oldest block not yet recycled, a block kept from a push that threw, and the last head seen.
+    alignas(cache_line_) std::atomic<size_t> tail_{0};
+    Bucket *tail_bucket_;
+    size_t tail_bucket_end_ = size_bucket_;
+    Bucket *first_bucket_;
+    Bucket *spare_bucket_ = nullptr;
+    size_t cached_head_ = 0;
+
+    // Consumer: the published start, the block being drained (published as well, everything
+    // before it can be recycled) and the index where it ends, and the last tail seen.
+    alignas(cache_line_) std::atomic<size_t> head_{0};
+    std::atomic<Bucket *> consumer_bucket_;
+    Bucket *head_bucket_;
+    size_t head_bucket_end_ = size_bucket_;
+    size_t cached_tail_ = 0;
+
+    // Free slots for the producer, rereading head_ only when the cached one shows fewer than `wanted`.
+    size_t Room(size_t tail, size_t wanted) {
+        if (capacity_ - (tail - cached_head_) < wanted) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+        }
+        return capacity_ - (tail - cached_head_);
+    }
+
+    // Filled slots for the consumer, up to `wanted`, rereading tail_ only when needed.
+    size_t Available(size_t head, size_t wanted) {
+        if (cached_tail_ - head < wanted) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+        }
+        return std::min(cached_tail_ - head, wanted);
+    }
+
+    // The block element `tail` goes to. Past the end of the tail block that is a recycled or new
+    // block, linked in by LinkBucket only once the element is constructed in it.
+    Bucket *BucketForPush(size_t tail) {
+        if (tail != tail_bucket_end_) {
+            return tail_bucket_;
+        }
+        if (spare_bucket_ == nullptr) {
+            if (first_bucket_ != consumer_bucket_.load(std::memory_order_acquire)) {
+                spare_bucket_ = first_bucket_;
+                first_bucket_ = first_bucket_->next;
+                spare_bucket_->next = nullptr;
+            } else {
+                spare_bucket_ = new Bucket;
+            }
+        }
+        return spare_bucket_;
+    }
+
+    void LinkBucket(Bucket *bucket) {
+        if (bucket != tail_bucket_) {
+            tail_bucket_->next = bucket;
+            tail_bucket_ = bucket;
+            tail_bucket_end_ += size_bucket_;
+            spare_bucket_ = nullptr;
+        }
+    }
+
+    // The block element `head` is in. The producer links a block before publishing anything in
+    // it, so `next` is there by the time the consumer gets to it.
+    Bucket *BucketForPop(size_t head) {
+        if (head == head_bucket_end_) {
+            head_bucket_ = head_bucket_->next;
+            head_bucket_end_ += size_bucket_;
+            consumer_bucket_.store(head_bucket_, std::memory_order_release);
+        }
+        return head_bucket_;
+    }
+};
@@ -0,0 +1,285 @@
+#pragma once
+
+#include "deque.cpp"
+#include "work_stealing_deque.cpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Counts the tasks submitted with it that have not finished yet. ThreadPool::wait blocks on it,
+// running other tasks in the meantime, and rethrows the first exception one of them threw.
+class WaitGroup {
+public:
+    WaitGroup() {}
+
+    WaitGroup(const WaitGroup &) = delete;
+    WaitGroup &operator=(const WaitGroup &) = delete;
+
+    void add(size_t count = 1) {
+        pending_.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    void done() {
+        pending_.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    bool finished() const {
+        return pending_.load(std::memory_order_acquire) == 0;
+    }
+
+private:
+    friend class ThreadPool;
+
+    std::atomic<size_t> pending_{0};
+    std::mutex error_mutex_;
+    std::exception_ptr error_;
+
+    void Fail(std::exception_ptr error) {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        if (!error_) {
+            error_ = std::move(error);
+        }
+    }
+};
+
+// A fixed set of worker threads, each with a WorkStealingDeque of tasks. A task submitted from a
+// worker goes to the bottom of that worker's deque, so fork-join code runs depth first on its own
+// thread while idle workers steal the oldest, largest pieces from the top; tasks from other
+// threads go through a shared queue. Idle workers sleep until something is submitted.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads = std::max(1u, std::thread::hardware_concurrency())) {
+        threads = std::max<size_t>(threads, 1);
+        for (size_t i = 0; i < threads; ++i) {
+            workers_.push_back(std::make_unique<Worker>());
+        }
+        try {
+            for (size_t i = 0; i < threads; ++i) {
+                workers_[i]->thread = std::thread(&ThreadPool::Run, this, i);
+            }
+        } catch (...) {
+            Stop();
+            throw;
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Runs what was already submitted, then joins the workers.
+    ~ThreadPool() {
+        Stop();
+    }
+
+    size_t size() const {
+        return workers_.size();
+    }
+
+    // Runs `function` on some worker. An exception escaping it terminates the program, as it
+    // would from a std::thread.
+    template<typename Function>
+    void submit(Function &&function) {
+        Push(new Task{std::function<void()>(std::forward<Function>(function)), nullptr});
+    }
+
+    // Runs `function` on some worker as part of `group`.
+    template<typename Function>
+    void submit(WaitGroup &group, Function &&function) {
+        group.add();
+        try {
+            Push(new Task{std::function<void()>(std::forward<Function>(function)), &group});
+        } catch (...) {
+            group.done();
+            throw;
+        }
+    }
+
+    // Returns once every task of `group` has finished, running tasks from the pool while it waits,
+    // so workers can wait on their own children. Rethrows the first exception of the group.
+    void wait(WaitGroup &group) {
+        while (!group.finished()) {
+            if (!RunOne()) {
+                std::this_thread::yield();
+            }
+        }
+        if (group.error_) {
+            std::exception_ptr error = std::move(group.error_);
+            group.error_ = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+    // Calls body(begin, end) on disjoint pieces of [first, last) of at most `grain` indices, in
+    // parallel, and returns when all of them are done. Pieces are split off by halving, so thieves
+    // take big ones.
+    template<typename Body>
+    void parallel_for(size_t first, size_t last, size_t grain, const Body &body) {
+        WaitGroup group;
+        try {
+            Split(group, first, last, std::max<size_t>(grain, 1), body);
+        } catch (...) {
+            group.Fail(std::current_exception());
+        }
+        wait(group);
+    }
+
+private:
+    struct Task {
+        std::function<void()> function;
+        WaitGroup *group;
+    };
+
+    struct Worker {
+        WorkStealingDeque<Task *> tasks;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    std::mutex shared_mutex_;
+    Deque<Task *> shared_tasks_;
+
+    // Tasks submitted and not yet taken, and workers asleep; a submitter wakes a worker only when
+    // one sleeps, and a worker sleeps only while there is nothing queued.
+    std::atomic<size_t> queued_{0};
+    std::atomic<size_t> sleeping_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+
+    static inline thread_local ThreadPool *current_pool_ = nullptr;
+    static inline thread_local size_t current_worker_ = 0;
+
+    template<typename Body>
+    void Split(WaitGroup &group, size_t first, size_t last, size_t grain, const Body &body) {
+        while (last - first > grain) {
+            size_t middle = first + (last - first) / 2;
+            submit(group, [this, &group, middle, last, grain, &body] {
+                Split(group, middle, last, grain, body);
+            });
+            last = middle;
+        }
+        if (first < last) {
+            body(first, last);
+        }
+    }
+
+    // Counts the task before publishing it, so that queued_ never drops below the tasks in flight.
+    void Push(Task *task) {
+        queued_.fetch_add(1, std::memory_order_seq_cst);
+        try {
+            if (current_pool_ == this) {
+                workers_[current_worker_]->tasks.push(task);
+            } else {
+                std::lock_guard<std::mutex> lock(shared_mutex_);
+                shared_tasks_.push_back(task);
+            }
+        } catch (...) {
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            delete task;
+            throw;
+        }
+        if (sleeping_.load(std::memory_order_seq_cst) > 0) {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            wake_.notify_one();
+        }
+    }
+
+    // Own deque first, then the shared queue, then a steal from every other worker in turn,
+    // starting at a random one.
+    Task *Take() {
+        Task *task = nullptr;
+        bool is_worker = current_pool_ == this;
+        if (is_worker && workers_[current_worker_]->tasks.pop(task)) {
+            return task;
+        }
+        {
+            std::lock_guard<std::mutex> lock(shared_mutex_);
+            if (shared_tasks_.size() > 0) {
+                task = shared_tasks_[0];
+                shared_tasks_.pop_front();
+                return task;
+            }
+        }
+        static thread_local uint64_t seed = std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        size_t start = seed % workers_.size();
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            size_t victim = (start + i) % workers_.size();
+            if (is_worker && victim == current_worker_) {
+                continue;
+            }
+            if (workers_[victim]->tasks.steal(task)) {
+                return task;
+            }
+        }
+        return nullptr;
+    }
+
+    bool RunOne() {
+        Task *task = Take();
+        if (task == nullptr) {
+            return false;
+        }
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+        std::unique_ptr<Task> owned(task);
+        if (task->group == nullptr) {
+            try {
+                task->function();
+            } catch (...) {
+                std::terminate();
+            }
+            return true;
+        }
+        try {
+            task->function();
+        } catch (...) {
+            task->group->Fail(std::current_exception());
+        }
+        task->group->done();
+        return true;
+    }
+
+    void Run(size_t index) {
+        current_pool_ = this;
+        current_worker_ = index;
+        while (true) {
+            if (RunOne()) {
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            sleeping_.fetch_add(1, std::memory_order_seq_cst);
+            wake_.wait(lock, [this] {
+                return queued_.load(std::memory_order_seq_cst) > 0 || stop_;
+            });
+            sleeping_.fetch_sub(1, std::memory_order_relaxed);
+            if (stop_ && queued_.load(std::memory_order_seq_cst) == 0) {
+                return;
+            }
+        }
+    }
+
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto &worker : workers_) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+    }
+};
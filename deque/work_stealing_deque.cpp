@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// The Chase–Lev work-stealing deque: its owner thread pushes and pops at the bottom, any
+// other thread may steal from the top. Elements sit in a circular array that the owner doubles
+// when it fills up; the arrays it outgrows are kept until the deque is destroyed, since a thief
+// may still be reading from one.
+//
+// The orderings follow Lê, Pop, Cohen and Zappa Nardelli, "Correct and efficient work-stealing
+// for weak memory models" (PPoPP 2013), with the fences folded into the neighbouring accesses.
+template<typename T>
+class WorkStealingDeque {
+    static_assert(std::is_trivially_copyable<T>::value, "elements are copied with plain atomic loads and stores");
+
+public:
+    explicit WorkStealingDeque(size_t capacity = 64) {
+        size_t size = 1;
+        while (size < capacity) {
+            size *= 2;
+        }
+        arrays_.push_back(std::make_unique<Array>(size));
+        array_.store(arrays_.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque &) = delete;
+    WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+    // Owner only.
+    void push(T item) {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        int64_t top = top_.load(std::memory_order_acquire);
+        Array *array = array_.load(std::memory_order_relaxed);
+        if (bottom - top >= int64_t(array->size)) {
+            array = Grow(array, top, bottom);
+        }
+        array->Put(bottom, item);
+        bottom_.store(bottom + 1, std::memory_order_release);
+    }
+
+    // Owner only: takes the most recently pushed element.
+    bool pop(T &item) {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        Array *array = array_.load(std::memory_order_relaxed);
+        bottom_.store(bottom, std::memory_order_seq_cst);
+        int64_t top = top_.load(std::memory_order_seq_cst);
+        if (top > bottom) {
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+        item = array->Get(bottom);
+        if (top == bottom) {
+            // The last element: race the thieves for it.
+            bool won = top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                                    std::memory_order_relaxed);
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // Any thread: takes the oldest element. Fails when the deque is empty or another thread won it.
+    bool steal(T &item) {
+        int64_t top = top_.load(std::memory_order_seq_cst);
+        int64_t bottom = bottom_.load(std::memory_order_seq_cst);
+        if (top >= bottom) {
+            return false;
+        }
+        Array *array = array_.load(std::memory_order_acquire);
+        item = array->Get(top);
+        return top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    // A snapshot, exact only when no other thread is running.
+    size_t size() const {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        int64_t top = top_.load(std::memory_order_relaxed);
+        return bottom > top ? size_t(bottom - top) : 0;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+private:
+    static constexpr size_t cache_line_ = 64;
+
+    struct Array {
+        size_t size;
+        std::unique_ptr<std::atomic<T>[]> items;
+
+        explicit Array(size_t size) : size(size), items(new std::atomic<T>[size]) {}
+
+        T Get(int64_t index) const {
+            return items[size_t(index) & (size - 1)].load(std::memory_order_relaxed);
+        }
+
+        void Put(int64_t index, T item) {
+            items[size_t(index) & (size - 1)].store(item, std::memory_order_relaxed);
+        }
+    };
+
+    alignas(cache_line_) std::atomic<int64_t> top_{0};
+    alignas(cache_line_) std::atomic<int64_t> bottom_{0};
+    std::atomic<Array *> array_;
+    std::vector<std::unique_ptr<Array>> arrays_;
+
+    Array *Grow(Array *array, int64_t top, int64_t bottom) {
+        arrays_.push_back(std::make_unique<Array>(array->size * 2));
+        Array *grown = arrays_.back().get();
+        for (int64_t i = top; i < bottom; ++i) {
+            grown->Put(i, array->Get(i));
+        }
+        array_.store(grown, std::memory_order_release);
+        return grown;
+    }
+};